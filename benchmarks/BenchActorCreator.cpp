@@ -0,0 +1,85 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Compares building a surface actor with the old per-element builders (SetPoint and
+// InsertNextCell/InsertCellPoint) against VtkActorCreator::generateSurfaceActor's bulk fill.
+// Both paths generate normals with vtkPolyDataNormals so the difference is the builder.
+// Usage: BenchActorCreator [ntriangles ...]   (default 100000 1000000 5000000)
+
+#include "BenchUtils.h"
+#include <VtkActorCreator.h>
+#include <VtkTools.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkPolyDataMapper.h>
+using RFeatures::ObjModel;
+using namespace RVTK::Bench;
+
+
+namespace {
+
+vtkSmartPointer<vtkPolyData> oldBuild( const ObjModel& model)
+{
+    const int nv = model.numVtxs();
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetNumberOfPoints( nv);
+    for ( int i = 0; i < nv; ++i)
+        points->SetPoint( i, &model.uvtx( i)[0]);
+
+    const int nf = model.numPolys();
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    for ( int f = 0; f < nf; ++f)
+    {
+        const int* fvidxs = model.fvidxs(f);
+        polys->InsertNextCell( 3);
+        polys->InsertCellPoint( fvidxs[0]);
+        polys->InsertCellPoint( fvidxs[1]);
+        polys->InsertCellPoint( fvidxs[2]);
+    }   // end for
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints( points);
+    pd->SetPolys( polys);
+    return pd;
+}   // end oldBuild
+
+
+vtkSmartPointer<vtkActor> oldActor( const ObjModel& model)
+{
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData( RVTK::generateNormals( oldBuild( model)));
+    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper( mapper);
+    return actor;
+}   // end oldActor
+
+}   // end namespace
+
+
+int main( int argc, char** argv)
+{
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {100000, 1000000, 5000000}))
+    {
+        const ObjModel::Ptr model = makeGridModel( n);
+        const size_t nf = size_t( model->numPolys());
+        printRow( "old points+cells", nf, timeMs( [&](){ oldBuild( *model);}));
+        printRow( "old actor", nf, timeMs( [&](){ oldActor( *model);}));
+        printRow( "generateSurfaceActor", nf, timeMs( [&](){ RVTK::VtkActorCreator::generateSurfaceActor( *model);}));
+        printRow( "generateSurfaceActor fast", nf, timeMs( [&](){ RVTK::VtkActorCreator::generateSurfaceActor( *model, true);}));
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,103 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Startup time to a first rendered frame of a textured model's actor: generating the actor from the
+// model against reading it from an actor cache file, both with the cache file's pages already in
+// memory (warm) and evicted from the page cache beforehand (cold, POSIX only; uses posix_fadvise
+// which only drops clean pages not mapped elsewhere). Each load renders in a new offscreen window
+// so the GPU upload is included. Model parsing is not included in the generation time.
+// Usage: BenchCacheStartup [ntriangles ...]   (default 100000 1000000 5000000)
+
+#include "BenchUtils.h"
+#include <ActorCacheFile.h>
+#include <VtkActorCreator.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace RVTK::Bench;
+
+
+namespace {
+
+void renderFirstFrame( vtkActor* actor)
+{
+    vtkSmartPointer<vtkRenderWindow> rwin = vtkSmartPointer<vtkRenderWindow>::New();
+    rwin->SetOffScreenRendering(1);
+    rwin->SetSize( 640, 480);
+    vtkSmartPointer<vtkRenderer> ren = vtkSmartPointer<vtkRenderer>::New();
+    rwin->AddRenderer( ren);
+    ren->AddActor( actor);
+    ren->ResetCamera();
+    rwin->Render();
+}   // end renderFirstFrame
+
+
+// Drop the file's pages from the page cache. Returns false if not supported.
+bool evict( const std::string& fname)
+{
+#ifdef _WIN32
+    return false;
+#else
+    const int fd = open( fname.c_str(), O_RDONLY);
+    if ( fd < 0)
+        return false;
+    fdatasync( fd);
+    const bool ok = posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close( fd);
+    return ok;
+#endif
+}   // end evict
+
+}   // end namespace
+
+
+int main( int argc, char** argv)
+{
+    const std::string fname = "bench_actor.cache";
+    const uint64_t KEY = 1;
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {100000, 1000000, 5000000}))
+    {
+        RFeatures::ObjModel::Ptr model = makeGridModel( n, 1, 2048);
+        vtkSmartPointer<vtkActor> actor = RVTK::VtkActorCreator::generateActor( *model);
+        if ( !RVTK::writeActorCacheFile( fname, actor, KEY))
+        {
+            std::cerr << "Unable to write " << fname << std::endl;
+            return 1;
+        }   // end if
+        actor = nullptr;
+
+        printRow( "generate+render", n, timeMs( [&](){ renderFirstFrame( RVTK::VtkActorCreator::generateActor( *model));}));
+        printRow( "cache warm+render", n, timeMs( [&](){ renderFirstFrame( RVTK::readActorCacheFile( fname, KEY));}));
+
+        double cold = -1;
+        for ( int i = 0; i < 3; ++i)
+        {
+            if ( !evict( fname))
+                break;
+            const double ms = timeMs( [&](){ renderFirstFrame( RVTK::readActorCacheFile( fname, KEY));}, 1);
+            cold = cold < 0 ? ms : std::min( cold, ms);
+        }   // end for
+        if ( cold >= 0)
+            printRow( "cache cold+render", n, cold);
+        std::remove( fname.c_str());
+    }   // end for
+    return 0;
+}   // end main
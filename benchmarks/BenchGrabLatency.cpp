@@ -0,0 +1,82 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Grab latency of ImageGrabber::refresh at a range of target heights from a 1920x1080 window:
+// rendering at window size and resizing, rendering at target through shrunken viewports (the
+// window is never resized), and the old render at target path which resized the window for every
+// grab (emulated here with SetSize around the render and reads). Pass "onscreen" as the first
+// argument to use an on screen window (where the old path also flickered).
+// Usage: BenchGrabLatency [onscreen] [height ...]   (default 240 480 720)
+
+#include "BenchUtils.h"
+#include <ImageGrabber.h>
+#include <VtkActorCreator.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <cstring>
+using namespace RVTK::Bench;
+
+
+int main( int argc, char** argv)
+{
+    const int W = 1920;
+    const int H = 1080;
+    const int NGRABS = 50;
+    const bool onscreen = argc > 1 && std::strcmp( argv[1], "onscreen") == 0;
+
+    vtkSmartPointer<vtkRenderWindow> rwin = vtkSmartPointer<vtkRenderWindow>::New();
+    rwin->SetOffScreenRendering( onscreen ? 0 : 1);
+    rwin->SetSize( W, H);
+    vtkSmartPointer<vtkRenderer> ren = vtkSmartPointer<vtkRenderer>::New();
+    rwin->AddRenderer( ren);
+    ren->AddActor( RVTK::VtkActorCreator::generateSurfaceActor( *makeGridModel( 1000000), true));
+    ren->ResetCamera();
+    rwin->Render();
+
+    RVTK::ImageGrabber grabber( rwin);
+    RVTK::FrameCapture capture( rwin);
+    cv::Mat_<cv::Vec3b> col;
+    cv::Mat_<float> z;
+    for ( size_t h : sizesFromArgs( argc, argv, onscreen ? 2 : 1, {240, 480, 720}))
+    {
+        const int rh = int(h);
+        const int rw = cvRound( rh * double(W) / H);
+        for ( int ss : {1, 2})
+        {
+            const std::string sfx = " (ss=" + std::to_string(ss) + ")";
+            grabber.setRenderAtTarget( false);
+            if ( ss == 1)
+                printRow( "window+resize", h, timeMs( [&](){ for ( int i = 0; i < NGRABS; ++i) grabber.refresh( rh);}) / NGRABS);
+
+            grabber.setRenderAtTarget( true, ss);
+            printRow( "at target" + sfx, h, timeMs( [&](){ for ( int i = 0; i < NGRABS; ++i) grabber.refresh( rh);}) / NGRABS);
+
+            printRow( "resize window" + sfx, h, timeMs( [&]()
+            {
+                for ( int i = 0; i < NGRABS; ++i)
+                {
+                    rwin->SetSize( rw*ss, rh*ss);
+                    rwin->Render();
+                    capture.readColour( col);
+                    capture.readDepth( z);
+                    rwin->SetSize( W, H);
+                }   // end for
+            }) / NGRABS);
+        }   // end for
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,154 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Load time and peak memory of RVTK's parallel mesh readers (readBinaryPLY, readBinarySTL and
+// readOBJ) against vtkPLYReader, vtkSTLReader and vtkOBJReader on grid meshes of the given
+// numbers of triangles. Peak RSS is per process so each load is done in a child process (this
+// program run with --load) from files written to the current directory beforehand (and removed
+// afterwards). The files are written in the host's byte order (little endian is assumed).
+// Usage: BenchMeshReaders [ntriangles ...]   (default 1000000 5000000 10000000)
+
+#include "BenchUtils.h"
+#include <MeshReaders.h>
+#include <vtkPLYReader.h>
+#include <vtkSTLReader.h>
+#include <vtkOBJReader.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+using namespace RVTK::Bench;
+
+
+namespace {
+
+template <typename T>
+void put( std::ofstream& ofs, const T& v) { ofs.write( reinterpret_cast<const char*>(&v), sizeof(T));}
+
+
+void writeMeshes( const RFeatures::ObjModel& model, const std::string& stem)
+{
+    const int nv = model.numVtxs();
+    const int nf = model.numPolys();
+
+    std::ofstream ply( stem + ".ply", std::ios::binary);
+    ply << "ply\nformat binary_little_endian 1.0\nelement vertex " << nv
+        << "\nproperty float x\nproperty float y\nproperty float z\nelement face " << nf
+        << "\nproperty list uchar int vertex_indices\nend_header\n";
+    for ( int i = 0; i < nv; ++i)
+        for ( int k = 0; k < 3; ++k)
+            put( ply, model.uvtx(i)[k]);
+    for ( int f = 0; f < nf; ++f)
+    {
+        put( ply, (unsigned char)3);
+        for ( int k = 0; k < 3; ++k)
+            put( ply, int32_t( model.fvidxs(f)[k]));
+    }   // end for
+
+    std::ofstream stl( stem + ".stl", std::ios::binary);
+    const char header[80] = "BenchMeshReaders";
+    stl.write( header, 80);
+    put( stl, uint32_t(nf));
+    for ( int f = 0; f < nf; ++f)
+    {
+        for ( int k = 0; k < 3; ++k)
+            put( stl, 0.0f);
+        for ( int j = 0; j < 3; ++j)
+            for ( int k = 0; k < 3; ++k)
+                put( stl, model.uvtx( model.fvidxs(f)[j])[k]);
+        put( stl, uint16_t(0));
+    }   // end for
+
+    std::ofstream obj( stem + ".obj");
+    for ( int i = 0; i < nv; ++i)
+    {
+        const cv::Vec3f& v = model.uvtx(i);
+        obj << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+    }   // end for
+    for ( int f = 0; f < nf; ++f)
+    {
+        const int* vidxs = model.fvidxs(f);
+        obj << "f " << vidxs[0]+1 << " " << vidxs[1]+1 << " " << vidxs[2]+1 << "\n";
+    }   // end for
+}   // end writeMeshes
+
+
+template <typename Reader>
+vtkSmartPointer<vtkPolyData> vtkRead( const std::string& fname)
+{
+    vtkSmartPointer<Reader> reader = vtkSmartPointer<Reader>::New();
+    reader->SetFileName( fname.c_str());
+    reader->Update();
+    return reader->GetOutput();
+}   // end vtkRead
+
+
+// Load the file with the named reader in this process and print the time and peak RSS.
+int load( const std::string& rname, const std::string& fname)
+{
+    vtkSmartPointer<vtkPolyData> pd;
+    const double ms = timeMs( [&]()
+    {
+        if ( rname == "readBinaryPLY")
+            pd = RVTK::readBinaryPLY( fname);
+        else if ( rname == "readBinarySTL")
+            pd = RVTK::readBinarySTL( fname);
+        else if ( rname == "readOBJ")
+            pd = RVTK::readOBJ( fname);
+        else if ( rname == "vtkPLYReader")
+            pd = vtkRead<vtkPLYReader>( fname);
+        else if ( rname == "vtkSTLReader")
+            pd = vtkRead<vtkSTLReader>( fname);
+        else if ( rname == "vtkOBJReader")
+            pd = vtkRead<vtkOBJReader>( fname);
+    }, 1);
+    if ( !pd)
+    {
+        std::cerr << rname << " failed to read " << fname << std::endl;
+        return 1;
+    }   // end if
+    printRow( rname, size_t( pd->GetNumberOfCells()), ms, peakRSSMiB());
+    return 0;
+}   // end load
+
+}   // end namespace
+
+
+int main( int argc, char** argv)
+{
+    if ( argc == 4 && std::strcmp( argv[1], "--load") == 0)
+        return load( argv[2], argv[3]);
+
+    const std::vector<std::pair<std::string, std::string> > runs =
+        {{"readBinaryPLY", ".ply"}, {"vtkPLYReader", ".ply"},
+         {"readBinarySTL", ".stl"}, {"vtkSTLReader", ".stl"},
+         {"readOBJ", ".obj"}, {"vtkOBJReader", ".obj"}};
+
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {1000000, 5000000, 10000000}))
+    {
+        const std::string stem = "bench_mesh_" + std::to_string(n);
+        writeMeshes( *makeGridModel( n), stem);
+        for ( const auto& run : runs)
+        {
+            const std::string cmd = std::string("\"") + argv[0] + "\" --load " + run.first + " " + stem + run.second;
+            if ( std::system( cmd.c_str()) != 0)
+                std::cerr << "Failed: " << cmd << std::endl;
+        }   // end for
+        for ( const char* ext : {".ply", ".stl", ".obj"})
+            std::remove( (stem + ext).c_str());
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,69 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Compares the memory and build time of VtkActorCreator::generateActors (one actor per material
+// sharing a single points buffer) against the old path of merging the model's materials into one
+// (ObjModel::mergeMaterials) and then calling generateActor.
+// Peak memory never falls so run each mode in its own process:
+// Usage: BenchMultiMaterial <actors|merge> [nmaterials=4] [ntriangles ...]   (default 100000 1000000)
+
+#include "BenchUtils.h"
+#include <VtkActorCreator.h>
+#include <cstring>
+using RFeatures::ObjModel;
+using namespace RVTK::Bench;
+
+
+int main( int argc, char** argv)
+{
+    const bool merge = argc > 1 && strcmp( argv[1], "merge") == 0;
+    if ( argc < 2 || (!merge && strcmp( argv[1], "actors") != 0))
+    {
+        std::cerr << "Usage: " << argv[0] << " <actors|merge> [nmaterials=4] [ntriangles ...]" << std::endl;
+        return 1;
+    }   // end if
+    const int nmats = argc > 2 ? std::max( 1, atoi( argv[2])) : 4;
+
+    for ( size_t n : sizesFromArgs( argc, argv, 3, {100000, 1000000}))
+    {
+        // The model is made (and merged) fresh for each run since merging modifies it.
+        double ms = 0;
+        double mib = 0;
+        size_t nf = 0;
+        for ( int rep = 0; rep < 3; ++rep)
+        {
+            ObjModel::Ptr model = makeGridModel( n, nmats);
+            nf = size_t( model->numPolys());
+            const double mib0 = peakRSSMiB();
+            std::vector<vtkSmartPointer<vtkActor> > actors;
+            const double t = timeMs( [&]()
+            {
+                if ( merge)
+                {
+                    model->mergeMaterials();
+                    actors.push_back( RVTK::VtkActorCreator::generateActor( *model));
+                }   // end if
+                else
+                    RVTK::VtkActorCreator::generateActors( *model, actors);
+            }, 1);
+            ms = rep == 0 ? t : std::min( ms, t);
+            mib = std::max( mib, peakRSSMiB() - mib0);
+        }   // end for
+        printRow( merge ? "merge + generateActor" : "generateActors", nf, ms, mib);
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,71 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Compares per vertex normals from vtkPolyDataNormals (as RVTK::generateNormals with its default
+// consistency and splitting, and with both off) against the native RVTK::calcVertexNormals
+// on one thread and on the default number of threads.
+// Usage: BenchNormals [ntriangles ...]   (default 1000000 4000000)
+
+#include "BenchUtils.h"
+#include <VtkTools.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+using RFeatures::ObjModel;
+using namespace RVTK::Bench;
+
+
+namespace {
+
+vtkSmartPointer<vtkPolyData> toPolyData( const ObjModel& model)
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    const int nv = model.numVtxs();
+    points->SetNumberOfPoints( nv);
+    for ( int i = 0; i < nv; ++i)
+        points->SetPoint( i, &model.uvtx(i)[0]);
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    const int nf = model.numPolys();
+    for ( int f = 0; f < nf; ++f)
+    {
+        const int* fvidxs = model.fvidxs(f);
+        const vtkIdType ids[3] = { fvidxs[0], fvidxs[1], fvidxs[2]};
+        polys->InsertNextCell( 3, ids);
+    }   // end for
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints( points);
+    pd->SetPolys( polys);
+    return pd;
+}   // end toPolyData
+
+}   // end namespace
+
+
+int main( int argc, char** argv)
+{
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {1000000, 4000000}))
+    {
+        const ObjModel::Ptr model = makeGridModel( n);
+        const vtkSmartPointer<vtkPolyData> pd = toPolyData( *model);
+        const size_t nf = size_t( model->numPolys());
+        std::vector<cv::Vec3f> vnrms;
+        printRow( "vtkPolyDataNormals", nf, timeMs( [&](){ RVTK::generateNormals( pd);}));
+        printRow( "vtkPolyDataNormals plain", nf, timeMs( [&](){ RVTK::generateNormals( pd, false, false);}));
+        printRow( "calcVertexNormals 1 thread", nf, timeMs( [&](){ RVTK::calcVertexNormals( *model, vnrms, 1);}));
+        printRow( "calcVertexNormals", nf, timeMs( [&](){ RVTK::calcVertexNormals( *model, vnrms);}));
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,62 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Pick latency against mesh size for RendererPicker's persistent pickers and cached cell locators.
+// The first pick includes building the locator; the others are the mean over random points.
+// Usage: BenchPickLatency [ntriangles ...]   (default 100000 1000000 5000000)
+
+#include "BenchUtils.h"
+#include <RendererPicker.h>
+#include <VtkActorCreator.h>
+#include <VtkTools.h>
+#include <vtkRenderWindow.h>
+#include <random>
+using namespace RVTK::Bench;
+
+
+int main( int argc, char** argv)
+{
+    const int W = 1024;
+    const int H = 768;
+    const int NPICKS = 1000;
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {100000, 1000000, 5000000}))
+    {
+        vtkSmartPointer<vtkRenderWindow> rwin = vtkSmartPointer<vtkRenderWindow>::New();
+        rwin->SetOffScreenRendering(1);
+        rwin->SetSize( W, H);
+        vtkSmartPointer<vtkRenderer> ren = vtkSmartPointer<vtkRenderer>::New();
+        rwin->AddRenderer( ren);
+        vtkSmartPointer<vtkActor> actor = RVTK::VtkActorCreator::generateSurfaceActor( *makeGridModel( n), true);
+        ren->AddActor( actor);
+        ren->ResetCamera();
+        rwin->Render();
+
+        RVTK::RendererPicker picker( ren);
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> px( 0, W-1), py( 0, H-1);
+        std::vector<cv::Point> pts( NPICKS);
+        for ( cv::Point& p : pts)
+            p = cv::Point( px(rng), py(rng));
+
+        const size_t nf = size_t( RVTK::getPolyData( actor)->GetNumberOfCells());
+        printRow( "first pickCell", nf, timeMs( [&](){ picker.clearLocators(); picker.pickCell( pts[0]);}, 1));
+        printRow( "pickCell (mean)", nf, timeMs( [&](){ for ( const cv::Point& p : pts) picker.pickCell( p);}) / NPICKS);
+        printRow( "pickNormal (mean)", nf, timeMs( [&](){ for ( const cv::Point& p : pts) picker.pickNormal( p);}) / NPICKS);
+        printRow( "pickActor (mean)", nf, timeMs( [&](){ for ( const cv::Point& p : pts) picker.pickActor( p);}) / NPICKS);
+    }   // end for
+    return 0;
+}   // end main
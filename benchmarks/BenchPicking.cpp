@@ -0,0 +1,63 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Times RendererPicker::pickActorCells (a prop pick and cell pick per point) against
+// pickActorCellsBatched (one ID buffer render answered by lookup) for random points over an
+// offscreen rendering of a 1M triangle surface. Both the all-actors and single actor forms are timed.
+// Usage: BenchPicking [npoints ...]   (default 1000 10000 100000)
+
+#include "BenchUtils.h"
+#include <RendererPicker.h>
+#include <VtkActorCreator.h>
+#include <vtkRenderWindow.h>
+#include <random>
+using namespace RVTK::Bench;
+
+
+int main( int argc, char** argv)
+{
+    const int W = 1024;
+    const int H = 768;
+    vtkSmartPointer<vtkRenderWindow> rwin = vtkSmartPointer<vtkRenderWindow>::New();
+    rwin->SetOffScreenRendering(1);
+    rwin->SetSize( W, H);
+    vtkSmartPointer<vtkRenderer> ren = vtkSmartPointer<vtkRenderer>::New();
+    rwin->AddRenderer( ren);
+    ren->AddActor( RVTK::VtkActorCreator::generateSurfaceActor( *makeGridModel( 1000000), true));
+    vtkSmartPointer<vtkActor> actor = RVTK::VtkActorCreator::generateSurfaceActor( *makeGridModel( 20000), true);
+    ren->AddActor( actor);
+    ren->ResetCamera();
+    rwin->Render();
+
+    RVTK::RendererPicker picker( ren);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> px( 0, W-1), py( 0, H-1);
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {1000, 10000, 100000}))
+    {
+        std::vector<cv::Point> pts( n);
+        for ( cv::Point& p : pts)
+            p = cv::Point( px(rng), py(rng));
+
+        std::vector<RVTK::ActorSubset> picked;
+        std::vector<int> cids;
+        printRow( "pickActorCells", n, timeMs( [&](){ picked.clear(); picker.pickActorCells( pts, picked);}, 1));
+        printRow( "pickActorCellsBatched", n, timeMs( [&](){ picked.clear(); picker.pickActorCellsBatched( pts, picked);}));
+        printRow( "pickActorCells actor", n, timeMs( [&](){ cids.clear(); picker.pickActorCells( pts, actor, cids);}, 1));
+        printRow( "pickActorCellsBatched actor", n, timeMs( [&](){ cids.clear(); picker.pickActorCellsBatched( pts, actor, cids);}));
+    }   // end for
+    return 0;
+}   // end main
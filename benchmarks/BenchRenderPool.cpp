@@ -0,0 +1,65 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Render throughput of a RenderPool against its number of contexts. Each job renders the same
+// model from a ring of cameras; throughput is views rendered per second over all jobs. With the
+// contexts' image processing single threaded, throughput should scale with contexts up to the
+// number of cores (or the GPU/driver's limit) without oversubscribing the CPU.
+// Usage: BenchRenderPool [ncontexts ...]   (default 1 2 4 8)
+
+#include "BenchUtils.h"
+#include <RenderPool.h>
+#include <cmath>
+using namespace RVTK::Bench;
+using RFeatures::CameraParams;
+
+
+int main( int argc, char** argv)
+{
+    const size_t NTRIS = 200000;
+    const size_t NJOBS = 32;
+    const size_t NVIEWS = 16;
+    RFeatures::ObjModel::Ptr model = makeGridModel( NTRIS);
+    const float hw = 0.5f * float( std::sqrt( NTRIS/2.0));
+    const cv::Vec3f centre( hw, hw, 0);
+
+    std::vector<CameraParams> cps;
+    for ( size_t i = 0; i < NVIEWS; ++i)
+    {
+        const double a = 2 * CV_PI * double(i) / NVIEWS;
+        CameraParams cp( centre + cv::Vec3f( float(6 * hw * cos(a)), float(6 * hw * sin(a)), 6 * hw));
+        cp.focus = centre;
+        cp.up = cv::Vec3f( 0, 0, 1);
+        cps.push_back( cp);
+    }   // end for
+
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {1, 2, 4, 8}))
+    {
+        RVTK::RenderPool pool( cv::Size( 640, 480), n);
+        const double ms = timeMs( [&]()
+        {
+            std::vector<std::future<std::vector<RVTK::ViewImages> > > futs;
+            for ( size_t j = 0; j < NJOBS; ++j)
+                futs.push_back( pool.submit( model, cps));
+            for ( auto& f : futs)
+                f.get();
+        });
+        printRow( "RenderPool contexts", n, ms);
+        std::cout << "  views/s: " << (1000.0 * NJOBS * NVIEWS / ms) << std::endl;
+    }   // end for
+    return 0;
+}   // end main
@@ -0,0 +1,68 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Multi-view render throughput of OffscreenModelViewer::renderViews (one render per view written
+// straight into the caller's images) against setting the camera and taking a snapshot per view.
+// Usage: BenchRenderViews [nviews ...]   (default 16 64 256)
+
+#include "BenchUtils.h"
+#include <OffscreenModelViewer.h>
+#include <cmath>
+using namespace RVTK::Bench;
+using RFeatures::CameraParams;
+
+
+int main( int argc, char** argv)
+{
+    const size_t NTRIS = 200000;
+    RFeatures::ObjModel::Ptr model = makeGridModel( NTRIS);
+    const cv::Vec3f centre( 0.5f * float(std::sqrt( NTRIS/2.0)), 0.5f * float(std::sqrt( NTRIS/2.0)), 0);
+    const float rad = 3 * centre[0];
+
+    RVTK::OffscreenModelViewer viewer( cv::Size( 640, 480));
+    viewer.setModel( *model);
+
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {16, 64, 256}))
+    {
+        std::vector<CameraParams> cps;
+        for ( size_t i = 0; i < n; ++i)
+        {
+            const double a = 2 * CV_PI * double(i) / n;
+            CameraParams cp( centre + cv::Vec3f( float(rad * cos(a)), float(rad * sin(a)), rad));
+            cp.focus = centre;
+            cp.up = cv::Vec3f( 0, 0, 1);
+            cps.push_back( cp);
+        }   // end for
+
+        std::vector<RVTK::ViewImages> views;
+        viewer.renderViews( cps, views);    // Warm up (allocates the view images)
+        const double rvms = timeMs( [&](){ viewer.renderViews( cps, views);});
+        const double snms = timeMs( [&]()
+        {
+            for ( const CameraParams& cp : cps)
+            {
+                viewer.setCamera( cp);
+                viewer.snapshot();
+                viewer.lightnessSnapshot();
+            }   // end for
+        });
+        printRow( "renderViews", n, rvms);
+        printRow( "setCamera+snapshots", n, snms);
+        std::cout << "  views/s: " << (1000.0 * n / rvms) << " vs " << (1000.0 * n / snms) << std::endl;
+    }   // end for
+    return 0;
+}   // end main
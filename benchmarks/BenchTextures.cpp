@@ -0,0 +1,73 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Time and peak memory of RVTK::convertToTexture (one parallel pass of row flips and vectorised
+// BGR to RGB conversions straight into VTK's scalar array) against the previous implementation
+// (cv::flip, then cv::split and cv::merge to swap channels, then a vtkImageImport) for square
+// 3 channel and 1 channel textures of the given sizes. Peak RSS is for the whole process so it
+// only grows; run once per size for per size memory figures.
+// Usage: BenchTextures [size ...]   (default 4096 8192)
+
+#include "BenchUtils.h"
+#include <VtkTools.h>
+#include <vtkImageImport.h>
+#include <vtkTexture.h>
+using namespace RVTK::Bench;
+
+
+namespace {
+
+// The implementation of convertToTexture before it was made a single pass.
+vtkSmartPointer<vtkTexture> oldConvertToTexture( const cv::Mat& image)
+{
+    cv::Mat img;
+    cv::flip( image, img, 0);
+    if ( image.channels() == 3)
+    {
+        std::vector<cv::Mat> channels;
+        cv::split( img, channels);
+        cv::Mat swappedChannels[3] = {channels[2], channels[1], channels[0]};
+        cv::Mat nimg;
+        cv::merge( swappedChannels, 3, nimg);
+        img = nimg;
+    }   // end if
+
+    vtkSmartPointer<vtkImageImport> importer = RVTK::makeImageImporter( img);
+    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+    texture->SetInputConnection( importer->GetOutputPort());
+    texture->Update();
+    return texture;
+}   // end oldConvertToTexture
+
+}   // end namespace
+
+
+int main( int argc, char** argv)
+{
+    for ( size_t n : sizesFromArgs( argc, argv, 1, {4096, 8192}))
+    {
+        for ( int type : {CV_8UC3, CV_8UC1})
+        {
+            cv::Mat img( int(n), int(n), type);
+            cv::randu( img, cv::Scalar::all(0), cv::Scalar::all(255));
+            const std::string sfx = type == CV_8UC3 ? " (BGR)" : " (grey)";
+            printRow( "old convertToTexture" + sfx, n, timeMs( [&](){ oldConvertToTexture( img);}), peakRSSMiB());
+            printRow( "convertToTexture" + sfx, n, timeMs( [&](){ RVTK::convertToTexture( img);}), peakRSSMiB());
+        }   // end for
+    }   // end for
+    return 0;
+}   // end main
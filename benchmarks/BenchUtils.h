@@ -0,0 +1,146 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+/**
+ * Helpers shared by the benchmark executables: wall clock timing, peak resident
+ * memory and synthetic (optionally textured) grid meshes of a given size.
+ */
+
+#ifndef RVTK_BENCH_UTILS_H
+#define RVTK_BENCH_UTILS_H
+
+#include <ObjModel.h>   // RFeatures
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace RVTK {
+namespace Bench {
+
+// Milliseconds taken by the fastest of reps calls to fn.
+inline double timeMs( const std::function<void()>& fn, int reps=3)
+{
+    double best = 0;
+    for ( int i = 0; i < reps; ++i)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - t0).count();
+        best = i == 0 ? ms : std::min( best, ms);
+    }   // end for
+    return best;
+}   // end timeMs
+
+
+// Peak resident memory of the process so far in MiB. Since the peak never falls, compare
+// memory use by running each variant in its own process.
+inline double peakRSSMiB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if ( !GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return double( pmc.PeakWorkingSetSize) / (1024*1024);
+#else
+    struct rusage ru;
+    getrusage( RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return double( ru.ru_maxrss) / (1024*1024);   // Bytes
+#else
+    return double( ru.ru_maxrss) / 1024;          // KiB
+#endif
+#endif
+}   // end peakRSSMiB
+
+
+// Sizes given on the command line from argument i onwards (or the defaults if none).
+inline std::vector<size_t> sizesFromArgs( int argc, char** argv, int i, const std::vector<size_t>& defaults)
+{
+    std::vector<size_t> sizes;
+    for ( ; i < argc; ++i)
+        sizes.push_back( size_t( std::strtoull( argv[i], nullptr, 10)));
+    return sizes.empty() ? defaults : sizes;
+}   // end sizesFromArgs
+
+
+// A wavy grid of (at least) ntris triangles with sequential IDs. If nmats > 0, the grid is split
+// into nmats vertical bands each with its own material and a texSize x texSize texture with
+// faces given texture coordinates spanning their band.
+inline RFeatures::ObjModel::Ptr makeGridModel( size_t ntris, int nmats=0, int texSize=512)
+{
+    const int w = std::max( 1, int( std::ceil( std::sqrt( double(ntris) / 2))));
+    const int h = std::max( 1, int( (ntris + 2*size_t(w) - 1) / (2*size_t(w))));
+    RFeatures::ObjModel::Ptr model = RFeatures::ObjModel::create();
+    for ( int y = 0; y <= h; ++y)
+        for ( int x = 0; x <= w; ++x)
+            model->addVertex( float(x), float(y), 0.5f * std::sin( 0.1f*x) * std::cos( 0.1f*y));
+
+    std::vector<int> mids;
+    for ( int m = 0; m < nmats; ++m)
+    {
+        const int mid = model->addMaterial();
+        cv::Mat tx( texSize, texSize, CV_8UC3);
+        cv::randu( tx, cv::Scalar::all(0), cv::Scalar::all(255));
+        model->addMaterialTexture( mid, tx);
+        mids.push_back( mid);
+    }   // end for
+
+    const int rw = w + 1;
+    const auto uv = [&]( int x, int y){ return cv::Vec2f( float(x)/w, float(y)/h);};
+    for ( int y = 0; y < h; ++y)
+    {
+        for ( int x = 0; x < w; ++x)
+        {
+            const int v0 = y*rw + x;
+            const int f0 = model->addFace( v0, v0 + 1, v0 + rw + 1);
+            const int f1 = model->addFace( v0, v0 + rw + 1, v0 + rw);
+            if ( nmats > 0)
+            {
+                const int mid = mids[size_t(x) * nmats / w];
+                model->setOrderedFaceUVs( mid, f0, uv(x,y), uv(x+1,y), uv(x+1,y+1));
+                model->setOrderedFaceUVs( mid, f1, uv(x,y), uv(x+1,y+1), uv(x,y+1));
+            }   // end if
+        }   // end for
+    }   // end for
+    return model;
+}   // end makeGridModel
+
+
+inline void printRow( const std::string& label, size_t n, double ms, double mib=-1)
+{
+    std::cout << std::left << std::setw(28) << label << std::right << std::setw(10) << n
+              << std::fixed << std::setprecision(1) << std::setw(12) << ms << " ms";
+    if ( mib >= 0)
+        std::cout << std::setw(10) << mib << " MiB";
+    std::cout << std::endl;
+}   // end printRow
+
+}   // end namespace
+}   // end namespace
+
+#endif
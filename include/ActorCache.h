@@ -0,0 +1,88 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_ACTOR_CACHE_H
+#define RVTK_ACTOR_CACHE_H
+
+#include "rVTK_Export.h"
+#include <ObjModel.h>   // RFeatures
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <unordered_map>
+#include <list>
+
+namespace RVTK {
+
+// A least recently used cache of actors (with their geometry and textures) keyed by model.
+// Entries are evicted in LRU order whenever the total size of cached actors exceeds the
+// byte budget (the most recently added actor is always kept even if it alone exceeds it).
+class rVTK_EXPORT ActorCache
+{
+public:
+    explicit ActorCache( size_t byteBudget);
+
+    // Return a key for the model from its content (vertices, faces, texture coordinates, texture
+    // pixels and transform) so different model objects with the same content share a key.
+    // This reads the whole model so is O(model size); where the caller already has a cheap
+    // identifier for a model (e.g. from its source file), use that as the key instead.
+    static size_t hash( const RFeatures::ObjModel&);
+
+    // Approximate memory used by the actor's polydata and texture image in bytes.
+    static size_t actorBytes( vtkActor*);
+
+    // Return the actor cached against the given key (making it the most recently used)
+    // or null if not cached.
+    vtkSmartPointer<vtkActor> get( size_t key);
+
+    // Cache the actor against the given key (replacing any existing) evicting as necessary.
+    void put( size_t key, vtkSmartPointer<vtkActor>);
+
+    void clear();
+
+    // Set the byte budget evicting as necessary.
+    void setBudget( size_t);
+    size_t budget() const { return _budget;}
+
+    size_t size() const { return _entries.size();}  // Number of cached actors
+    size_t bytes() const { return _bytes;}          // Total bytes of cached actors
+    size_t hits() const { return _hits;}
+    size_t misses() const { return _misses;}
+    size_t evictions() const { return _evictions;}
+
+private:
+    struct Entry
+    {
+        size_t key;
+        vtkSmartPointer<vtkActor> actor;
+        size_t bytes;
+    };  // end struct
+
+    size_t _budget;
+    size_t _bytes;
+    size_t _hits, _misses, _evictions;
+    std::list<Entry> _entries;   // Most recently used at front
+    std::unordered_map<size_t, std::list<Entry>::iterator> _lookup;
+
+    void evict();
+
+    ActorCache( const ActorCache&) = delete;
+    void operator=( const ActorCache&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
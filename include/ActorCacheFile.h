@@ -0,0 +1,58 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_ACTOR_CACHE_FILE_H
+#define RVTK_ACTOR_CACHE_FILE_H
+
+#include "rVTK_Export.h"
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <cstdint>
+#include <string>
+
+namespace RVTK {
+
+// A binary on-disk cache of a single actor's final VTK arrays so the actor can be reloaded without
+// repeating model parsing, actor generation, normal generation or texture conversion. The file has
+// a versioned header and a table of arrays followed by the points, every point and cell data array
+// (by name, with their active attributes such as normals and texture coordinates), the verts, lines,
+// polys and strips (legacy cell array layout) and the texture bytes, each aligned as VTK needs them.
+// Reading memory maps the file (copy on write) and wraps the regions directly as VTK arrays with no
+// parsing or copying; the mapping is released when the last of the arrays is deleted. Only files
+// written on a machine of the same byte order and vtkIdType size are read.
+
+// Return a fast (non-cryptographic) 64 bit hash of the contents of the given file (0 if unreadable).
+rVTK_EXPORT uint64_t hashFile( const std::string& fname);
+
+// Write the given actor's polydata, texture, transform and lighting properties to fname tagged with
+// the given source key (typically the hashFile of the file the actor was made from). The file is
+// written to a temporary file and atomically renamed over any existing cache so a partially written
+// cache is never read and there's never a moment without one.
+// Returns false on failure, including if the actor has arrays that can't be stored (non-numeric
+// or non-contiguous arrays, names of 64 or more characters, or a texture that isn't 1 to 4 bytes
+// per texel) since caching the actor without them would change its behaviour when reloaded.
+rVTK_EXPORT bool writeActorCacheFile( const std::string& fname, vtkActor*, uint64_t sourceKey);
+
+// Read an actor from the given cache file. Returns null if the file doesn't exist, has a different
+// version or was written for a different source key (in which case the caller should regenerate it).
+// Also returns null if any region's size doesn't exactly match the counts in the header or lies
+// outside the file. The actor's transform is restored as its user matrix.
+rVTK_EXPORT vtkSmartPointer<vtkActor> readActorCacheFile( const std::string& fname, uint64_t sourceKey);
+
+}   // end namespace
+
+#endif
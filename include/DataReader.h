@@ -50,6 +50,8 @@ private:
 }; // end DataReaderException
 
 
+// Reads BYU (.g), legacy VTK (.vtk), PLY, STL and OBJ files. PLY, STL and OBJ are read
+// through MeshFileReader (reporting progress and honouring AbortExecute on update).
 class rVTK_EXPORT DataReader
 {
 public:
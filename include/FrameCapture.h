@@ -0,0 +1,102 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_FRAME_CAPTURE_H
+#define RVTK_FRAME_CAPTURE_H
+
+#include "rVTK_Export.h"
+#include <opencv2/opencv.hpp>
+#include <vtkSmartPointer.h>
+#include <vtkRenderWindow.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkFloatArray.h>
+
+namespace RVTK {
+
+class Viewer;
+
+// Reads colour and depth buffers from a render window into OpenCV images. The readback
+// arrays are kept between calls and the output images are only reallocated if the window
+// size changes, so a single FrameCapture should be reused for repeated captures from the
+// same window. The vertical flip (and RGB to BGR swap for colour) are done by OpenCV's
+// vectorised cv::flip and cv::cvtColor straight into the output image.
+//
+// Colour can also be read back asynchronously through a pair of OpenGL pixel pack buffers:
+// beginColourRead queues the copy of the current frame on the GPU and returns immediately,
+// and endColourRead collects the oldest queued frame. Calling beginColourRead after each
+// render and endColourRead after the next overlaps each frame's readback with the rendering
+// of the one after it (at one frame of latency). This needs an OpenGL render window.
+class rVTK_EXPORT FrameCapture
+{
+public:
+    explicit FrameCapture( vtkRenderWindow*);
+
+    // Capture from the viewer's render window adding the time of each read to the
+    // viewer's render statistics (as readback time) whenever they are enabled.
+    explicit FrameCapture( Viewer&);
+
+    // Releases any pixel buffers (the render window must still exist).
+    ~FrameCapture();
+
+    // Read the colour buffer of the most recently rendered frame as BGR with a top left origin.
+    void readColour( cv::Mat_<cv::Vec3b>&);
+
+    // Queue an asynchronous read of the colour buffer of the most recently rendered frame.
+    // At most two reads are kept; if both are still queued, the older is dropped.
+    // Returns false if the render window isn't an OpenGL window or has no size.
+    bool beginColourRead();
+
+    // Collect the oldest queued colour read into img (as for readColour) waiting for it only
+    // if the GPU hasn't yet finished the copy. Returns false if no read is queued (or it can't be mapped).
+    bool endColourRead( cv::Mat_<cv::Vec3b>&);
+
+    // Read the raw (non-linear [0,1]) Z-buffer of the most recently rendered frame with a top left origin.
+    void readDepth( cv::Mat_<float>&);
+
+    // Set which buffer is read from (front by default as for vtkWindowToImageFilter).
+    void setReadFrontBuffer( bool v) { _front = v;}
+    bool readFrontBuffer() const { return _front;}
+
+    // Read only a region of the given size from the bottom left corner of the window (e.g. when
+    // the renderers' viewports have been shrunk to render into part of it). An empty size (the
+    // default) reads the whole window. The region is clipped to the window.
+    void setReadSize( const cv::Size& sz) { _rsz = sz;}
+    const cv::Size& readSize() const { return _rsz;}
+
+    vtkRenderWindow* renderWindow() const { return _renWin;}
+
+private:
+    vtkRenderWindow* _renWin;
+    Viewer* _viewer;
+    vtkSmartPointer<vtkUnsignedCharArray> _rgb;
+    vtkSmartPointer<vtkFloatArray> _z;
+    bool _front;
+    cv::Size _rsz;
+    unsigned int _pbo[2];       // Pixel pack buffers for asynchronous colour reads (0 until used)
+    size_t _pboBytes[2];
+    cv::Size _pboSize[2];
+    bool _pending[2];
+    int _next;                  // The pixel buffer to use for the next beginColourRead
+    cv::Size regionSize() const;
+
+    FrameCapture( const FrameCapture&) = delete;
+    void operator=( const FrameCapture&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
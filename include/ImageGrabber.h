@@ -19,6 +19,7 @@
 #define RVTK_IMAGE_GRABBER_H
 
 #include "Viewer.h"
+#include "FrameCapture.h"
 using byte = unsigned char;
 
 namespace RVTK {
@@ -28,24 +29,81 @@ class rVTK_EXPORT ImageGrabber
 public:
     // Grabs the current set of images from the passed in render window and scales to requested height.
     // If height is left as non-positive, produced images are the same size as the render window.
-    ImageGrabber( vtkRenderWindow*, int reqPixelHeight=0);
-    ImageGrabber( Viewer&, int reqPixelHeight=0);
+    // The first refresh happens on construction using the given render at target and supersample
+    // settings (see setRenderAtTarget) so a small target is only ever rendered at its own size.
+    ImageGrabber( vtkRenderWindow*, int reqPixelHeight=0, bool renderAtTarget=false, int supersample=1);
+    ImageGrabber( Viewer&, int reqPixelHeight=0, bool renderAtTarget=false, int supersample=1);
 
     // Refresh images (only needed if render window has been updated since construction).
+    // The readback buffers are reused between refreshes.
     void refresh( int reqPixelHeight = 0);
 
+    // As above, but write the images straight into the given (reused if already the right size) images
+    // rather than the grabber's own. Until the next refresh, the accessors below return these images.
+    void refresh( cv::Mat_<cv::Vec3b>& colour, cv::Mat_<byte>& light, cv::Mat_<float>& depth, int reqPixelHeight = 0);
+
+    // By default the images are read at window size and then resized to the requested height.
+    // If rendering at target resolution, only the required pixels are rendered and read back by
+    // shrinking the renderers' viewports to the bottom left of the window for the grab (so an on
+    // screen window is neither resized nor shows the partial frame). A supersample factor > 1 renders
+    // at that multiple of the requested size and box filters the colour image down (depth takes the
+    // nearest sample to avoid blending surfaces with background). The factor is clamped so the render
+    // fits in the window; only an offscreen window is temporarily resized for renders larger than it
+    // (up to the maximum OpenGL viewport).
+    void setRenderAtTarget( bool enable, int supersample=1);
+    inline bool renderAtTarget() const { return _atTarget;}
+    inline int supersample() const { return _ssample;}
+
+    // Set the maximum number of threads used to process the images (0 for defaultThreadCount). Set to 1
+    // when many grabbers run on their own threads (e.g. in a RenderPool) so they don't each spawn threads.
+    void setThreadCount( size_t n) { _nthreads = n;}
+    inline size_t threadCount() const { return _nthreads;}
+
     inline cv::Size size() const { return _colmap.size();}
     inline cv::Mat_<cv::Vec3b> colour() const { return _colmap;}
     inline cv::Mat_<byte> light() const { return _dcmap;}
     inline cv::Mat_<float> depth() const { return _dzmap;}
     inline cv::Mat_<byte> depthb() const { return _ddmap;}
 
+    // Linear eye-space depth in world units (zero for background) and the world position of the
+    // surface at each pixel (NaN for background) at the same size as the other images. Both are
+    // made together in a single unprojection pass through the camera as it was at the last refresh
+    // on the first request for either after a refresh. Pixels are mapped through the viewport of the
+    // window's first renderer so those outside it are also background.
+    cv::Mat_<float> linearDepth() const;
+    cv::Mat_<cv::Vec3f> points() const;
+
+    // Render ID buffers of the current view (so call without changing the camera since the last refresh)
+    // and set cids to the ID of the cell visible at each pixel (-1 for background) at the same size as
+    // the other images. If actor is given, pixels showing other actors are also set to -1. If bcoords
+    // is not null, it's set to the barycentric coordinates of each pixel's surface position within its
+    // (triangular) cell. Costs a single hardware selection pass rather than a pick per pixel with
+    // the IDs decoded straight from the selector's captured pass buffers.
+    // Returns false if the ID buffers could not be captured.
+    bool cellIds( cv::Mat_<int>& cids, vtkActor* actor=nullptr, cv::Mat_<cv::Vec3f>* bcoords=nullptr) const;
+
 private:
     vtkRenderWindow* _renWin;
+    FrameCapture _capture;
+    bool _atTarget;
+    int _ssample;
+    bool _external;               // True if the images below are the caller's from the last refresh
+    size_t _nthreads;
+    bool _direct;                 // True if the last render was read straight into the images below
+    cv::Mat_<cv::Vec3b> _rawcol;  // Colour buffer at render size (unused if read direct)
+    cv::Mat_<float> _rawz;        // Z-buffer at render size (unused if read direct)
     cv::Mat_<cv::Vec3b> _colmap;  // Original colour map
     cv::Mat_<byte> _dcmap;   // CIE-L light map
     cv::Mat_<float> _dzmap;  // Depth map (raw z-buffer floats)
     cv::Mat_<byte> _ddmap;   // Converted depth map
+    vtkSmartPointer<vtkCamera> _cam;    // Copy of the camera at the last refresh
+    double _aspect;
+    cv::Vec4d _viewport;                // Viewport of the camera's renderer at the last refresh
+    mutable bool _unprojected;
+    mutable cv::Mat_<float> _edmap;         // Linear eye-space depth
+    mutable cv::Mat_<cv::Vec3f> _ptsmap;    // World positions
+    void unproject() const;
+    void grab( cv::Mat_<cv::Vec3b>&, cv::Mat_<byte>&, cv::Mat_<float>&, int reqPixelHeight);
 
     ImageGrabber( const ImageGrabber&) = delete;
     void operator=( const ImageGrabber&) = delete;
@@ -0,0 +1,59 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_MAPPED_FILE_H
+#define RVTK_MAPPED_FILE_H
+
+#include "rVTK_Export.h"
+#include <string>
+
+namespace RVTK {
+
+// A read-only memory mapping of a whole file (unmapped on destruction). If copyOnWrite is true,
+// the mapped pages may be written to (via writableData) with changes private to this mapping.
+// The expected access pattern is passed to the OS (madvise or the Windows file open flags) so
+// that it reads ahead aggressively for SEQUENTIAL access (the default for parsing) and not at
+// all for RANDOM access (e.g. reading only a header and some of the regions it indexes).
+class rVTK_EXPORT MappedFile
+{
+public:
+    enum Access { NORMAL, SEQUENTIAL, RANDOM};
+
+    explicit MappedFile( const std::string& fname, bool copyOnWrite=false, Access access=SEQUENTIAL);
+    ~MappedFile();
+
+    bool isOpen() const { return _data != nullptr;}
+    const char* data() const { return _data;}
+    char* writableData() const { return _cow ? const_cast<char*>(_data) : nullptr;}  // Null unless copy on write
+    size_t size() const { return _size;}
+
+private:
+    const char* _data;
+    size_t _size;
+    bool _cow;
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#endif
+
+    MappedFile( const MappedFile&) = delete;
+    void operator=( const MappedFile&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
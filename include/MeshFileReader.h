@@ -0,0 +1,72 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+/**
+ * Source object reading PLY, STL and OBJ meshes (chosen by file extension)
+ * when the pipeline updates rather than when constructed. Binary PLY/STL
+ * and ASCII OBJ are read through the memory mapped parallel readers of
+ * MeshReaders.h with progress reported through UpdateProgress and the read
+ * cancelled when AbortExecute is set. Other forms (e.g. ASCII PLY/STL) fall
+ * back to the equivalent VTK reader.
+ */
+
+#pragma once
+#ifndef RVTK_MESH_FILE_READER_H
+#define RVTK_MESH_FILE_READER_H
+
+#include "VTKTypes.h"
+#include <vtkPolyDataAlgorithm.h>
+
+namespace RVTK
+{
+
+class rVTK_EXPORT MeshFileReader : public vtkPolyDataAlgorithm
+{
+public:
+   static MeshFileReader* New();
+   vtkTypeMacro( MeshFileReader, vtkPolyDataAlgorithm);
+   void PrintSelf( ostream& os, vtkIndent indent) override;
+
+   /**
+    * Set/Get the name of the mesh file (with extension .ply, .stl or .obj).
+    */
+   vtkSetStringMacro(FileName);
+   vtkGetStringMacro(FileName);
+
+   /**
+    * Set/Get the number of parsing threads (0 for the number of hardware threads; the default).
+    */
+   vtkSetMacro( NumberOfThreads, int);
+   vtkGetMacro( NumberOfThreads, int);
+
+protected:
+   MeshFileReader();
+   ~MeshFileReader() override;
+
+   char* FileName;
+   int NumberOfThreads;
+
+   int RequestData( vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+private:
+   MeshFileReader( const MeshFileReader&) = delete;
+   void operator=( const MeshFileReader&) = delete;
+}; // end class
+
+}   // end namespace
+
+#endif
@@ -0,0 +1,54 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_MESH_READERS_H
+#define RVTK_MESH_READERS_H
+
+#include "rVTK_Export.h"
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <functional>
+#include <string>
+
+namespace RVTK {
+
+// Fast mesh readers that memory map the file and fill the polydata's point and cell arrays
+// directly, decoding in parallel chunks over nthreads (0 for defaultThreadCount). Only geometry
+// is read (points and polygons). Each returns null if the file can't be read or isn't in the
+// form handled (so the caller can fall back to the equivalent VTK reader).
+//
+// If given, progress is called on the calling thread with the proportion [0,1] of the read done.
+// Returning false from it cancels the read and the reader returns null.
+using ReadProgressFn = std::function<bool(float)>;
+
+// Binary (little or big endian) PLY. Returns null for ASCII PLY or if the vertex element has list properties.
+rVTK_EXPORT vtkSmartPointer<vtkPolyData> readBinaryPLY( const std::string& fname, size_t nthreads=0,
+                                                             const ReadProgressFn& progress=nullptr);
+
+// Binary STL. Returns null for ASCII STL. Coincident triangle vertices are merged (as vtkSTLReader
+// does by default) unless mergePoints is false in which case every triangle has its own three points.
+rVTK_EXPORT vtkSmartPointer<vtkPolyData> readBinarySTL( const std::string& fname, bool mergePoints=true, size_t nthreads=0,
+                                                             const ReadProgressFn& progress=nullptr);
+
+// ASCII OBJ vertices and faces (texture coordinates, normals, groups and materials are ignored).
+// Lines are parsed in parallel over chunks of the file with relative (negative) indices supported.
+rVTK_EXPORT vtkSmartPointer<vtkPolyData> readOBJ( const std::string& fname, size_t nthreads=0,
+                                                       const ReadProgressFn& progress=nullptr);
+
+}   // end namespace
+
+#endif
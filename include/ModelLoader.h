@@ -0,0 +1,102 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_MODEL_LOADER_H
+#define RVTK_MODEL_LOADER_H
+
+#include "rVTK_Export.h"
+#include <ObjModel.h>   // RFeatures
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+
+namespace RVTK {
+
+// Progress of a single load (in [0,1]) that the caller can poll or use to cancel the load.
+class rVTK_EXPORT LoadProgress
+{
+public:
+    LoadProgress() : _progress(0), _cancelled(false) {}
+
+    float progress() const { return _progress;}
+    void cancel() { _cancelled = true;}     // The load stops at the next opportunity
+    bool cancelled() const { return _cancelled;}
+
+    void set( float p) { _progress = p;}    // Set by the loader
+
+private:
+    std::atomic<float> _progress;
+    std::atomic<bool> _cancelled;
+};  // end class
+
+
+// Loads models into actors on background threads so the calling (UI) thread isn't blocked.
+// File parsing (through DataReader), normal generation, actor construction and texture preparation
+// all happen on a worker thread; the render thread need only add the finished actor to its viewer.
+// Each load is given a LoadProgress to poll (or cancel) and an optional callback that's called on
+// the worker thread as progress is made. A load's future gives null if it was cancelled or failed.
+class rVTK_EXPORT ModelLoader
+{
+public:
+    using ProgressFn = std::function<void(float)>;
+    using ProgressPtr = std::shared_ptr<LoadProgress>;
+
+    // Create n loading threads (0 for defaultThreadCount).
+    explicit ModelLoader( size_t n=1);
+
+    // Cancels queued loads (their futures give null) and waits for loads in progress to finish.
+    ~ModelLoader();
+
+    // Queue loading of the given file (any format DataReader reads) into an actor with point normals.
+    // If progress is not null, it's set to the new load's progress object.
+    std::future<vtkSmartPointer<vtkActor> > load( const std::string& fname, ProgressPtr* progress=nullptr,
+                                                  const ProgressFn& fn=nullptr);
+
+    // Queue creation of a texture mapped actor from the given model (see VtkActorCreator::generateActor).
+    // The model must not be modified until the returned future is ready.
+    std::future<vtkSmartPointer<vtkActor> > load( const RFeatures::ObjModel::Ptr, ProgressPtr* progress=nullptr,
+                                                  const ProgressFn& fn=nullptr);
+
+    size_t size() const { return _threads.size();} // Number of loading threads
+    size_t pending() const; // Number of loads waiting for a thread
+
+private:
+    using Job = std::function<void(bool cancelled)>;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop;
+
+    std::future<vtkSmartPointer<vtkActor> > enqueue( const std::function<vtkSmartPointer<vtkActor>(LoadProgress&, const ProgressFn&)>&,
+                                                     ProgressPtr*, const ProgressFn&);
+    void run();
+
+    ModelLoader( const ModelLoader&) = delete;
+    void operator=( const ModelLoader&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
@@ -0,0 +1,143 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_NUMBER_PARSER_H
+#define RVTK_NUMBER_PARSER_H
+
+// Fast text number parsing over (not necessarily null terminated) character ranges
+// such as memory mapped files. Only spaces, tabs and carriage returns are skipped.
+
+#include <cstdint>
+#include <cmath>
+
+namespace RVTK {
+
+inline bool isDigit( char c) { return c >= '0' && c <= '9';}
+
+inline const char* skipSpace( const char* p, const char* e)
+{
+    while ( p < e && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    return p;
+}   // end skipSpace
+
+
+inline double powTen( int e)
+{
+    static const double POS[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                 1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+    if ( e >= 0 && e <= 22)
+        return POS[e];
+    if ( e < 0 && e >= -22)
+        return 1.0 / POS[-e];
+    return std::pow( 10.0, e);
+}   // end powTen
+
+
+// Locale independent float parse (C++14 has no from_chars) from p reading no further than e.
+// On success p is left after the number. Returns false (leaving p unchanged) if no number.
+inline bool parseFloat( const char*& p, const char* e, float& v)
+{
+    p = skipSpace( p, e);
+    const char* s = p;
+    bool neg = false;
+    if ( p < e && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+
+    uint64_t mant = 0;
+    int nd = 0;     // Significant digits in mant
+    int exp10 = 0;
+    bool any = false;
+    for ( ; p < e && isDigit(*p); ++p, any = true)
+    {
+        const int d = *p - '0';
+        if ( nd < 19)
+        {
+            if ( mant > 0 || d > 0)
+            {
+                mant = mant*10 + uint64_t(d);
+                nd++;
+            }   // end if
+        }   // end if
+        else
+            exp10++;
+    }   // end for
+    if ( p < e && *p == '.')
+    {
+        for ( ++p; p < e && isDigit(*p); ++p, any = true)
+        {
+            const int d = *p - '0';
+            if ( nd < 19)
+            {
+                if ( mant > 0 || d > 0)
+                {
+                    mant = mant*10 + uint64_t(d);
+                    nd++;
+                }   // end if
+                exp10--;
+            }   // end if
+        }   // end for
+    }   // end if
+
+    if ( !any)
+    {
+        p = s;
+        return false;
+    }   // end if
+
+    if ( p < e && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p+1;
+        bool eneg = false;
+        if ( q < e && (*q == '-' || *q == '+'))
+            eneg = *q++ == '-';
+        if ( q < e && isDigit(*q))
+        {
+            int ev = 0;
+            for ( ; q < e && isDigit(*q); ++q)
+                if ( ev < 10000)
+                    ev = ev*10 + (*q - '0');
+            exp10 += eneg ? -ev : ev;
+            p = q;
+        }   // end if
+    }   // end if
+
+    const double d = double(mant) * powTen( exp10);
+    v = float( neg ? -d : d);
+    return true;
+}   // end parseFloat
+
+
+// Parse a signed integer from p reading no further than e (p left after it). Returns false if no integer.
+inline bool parseInt( const char*& p, const char* e, int64_t& v)
+{
+    p = skipSpace( p, e);
+    bool neg = false;
+    if ( p < e && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    if ( p >= e || !isDigit(*p))
+        return false;
+    int64_t x = 0;
+    for ( ; p < e && isDigit(*p); ++p)
+        x = x*10 + (*p - '0');
+    v = neg ? -x : x;
+    return true;
+}   // end parseInt
+
+}   // end namespace
+
+#endif
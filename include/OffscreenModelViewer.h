@@ -19,13 +19,25 @@
 #define RVTK_OFFSCREEN_MODEL_VIEWER_H
 
 #include <RendererPicker.h>
+#include <ActorCache.h>
+#include <ImageGrabber.h>
 #include <Viewer.h>
 #include <ObjModel.h>       // RFeatures
 #include <CameraParams.h>   // RFeatures
+#include <functional>
 using byte = unsigned char;
 
 namespace RVTK {
 
+// The images rendered for a single view.
+struct rVTK_EXPORT ViewImages
+{
+    cv::Mat_<cv::Vec3b> colour;
+    cv::Mat_<byte> light;   // Contrast stretched CIE-L lightness
+    cv::Mat_<float> depth;  // Raw z-buffer values
+};  // end struct
+
+
 class rVTK_EXPORT OffscreenModelViewer
 {
 public:
@@ -36,7 +48,19 @@ public:
 
     void clear();   // Clear the viewer (remove and delete the actor).
 
-    void setModel( const RFeatures::ObjModel&); // Reset the viewer with the given model.
+    // Reset the viewer with the given model. If actor caching is on, the actor is cached against
+    // the given key which should uniquely identify the model's content (e.g. from hashFile of its
+    // source) so that setting a model again with the same key only swaps actors. If no key is
+    // given (zero), ActorCache::hash is used which costs a pass over the whole model.
+    void setModel( const RFeatures::ObjModel&, size_t key=0);
+
+    // Cache the actors created by setModel within the given byte budget so switching back to
+    // a recently set model only swaps actors. Caching is off by default; setting a zero budget
+    // turns it off again (discarding any cached actors).
+    void setActorCacheBudget( size_t bytes);
+
+    // Returns the actor cache (for hit/miss/eviction statistics) or null if caching is off.
+    const ActorCache* actorCache() const { return _cache.get();}
 
     void setSize( const cv::Size&); // Set size of the viewer for snapshots
 
@@ -44,10 +68,34 @@ public:
 
     void setBackgroundColour( double r, double g, double b);
 
+    // Set the maximum number of threads used to process snapshot images (0 for defaultThreadCount).
+    void setThreadCount( size_t n);
+
     // Take and return a snapshot of the scene.
     cv::Mat_<cv::Vec3b> snapshot() const;
     cv::Mat_<byte> lightnessSnapshot() const;
 
+    // Render the current model from each of the given cameras in turn, setting the images for
+    // each view in the corresponding entry of views (which is resized to match). Each view costs
+    // a single render and the same capture buffers are used for every view. The images are written
+    // straight into the entries of views (reusing their buffers if already the right size). On return,
+    // the camera is left at the last of the given camera parameters.
+    void renderViews( const std::vector<RFeatures::CameraParams>&, std::vector<ViewImages>& views);
+
+    // Called with each rendered tile of a tiled rendering giving the tile's region within the full
+    // image and its colour and raw z-buffer images. The images are only valid for the duration of
+    // the call. Return false to stop rendering further tiles.
+    using TileFn = std::function<bool( const cv::Rect&, const cv::Mat_<cv::Vec3b>&, const cv::Mat_<float>&)>;
+
+    // Render an image of arbitrary size (not limited by the maximum framebuffer size) from the current
+    // camera as a grid of tiles the size of the viewer, passing each tile to fn in row major order as it's
+    // rendered so only a single tile is ever held in memory. Each tile narrows the camera's view angle and
+    // shifts its window centre to the tile's part of the full view. The clipping range is fixed over all
+    // tiles so the z-buffer values are consistent. Edge tiles are cropped to the image. FXAA is turned off
+    // while rendering the tiles since it would leave seams at their edges. The camera (and FXAA setting)
+    // is restored on return. Returns the number of tiles passed to fn.
+    int renderTiled( const cv::Size& imgSize, const TileFn& fn);
+
     // The following picking operations all use the top left as the image plane origin.
 
     // Returns true if given point (with top left origin) intersects with the current model/actor.
@@ -63,7 +111,11 @@ private:
     vtkSmartPointer<vtkActor> _actor;
     Viewer::Ptr _viewer;
     mutable RendererPicker *_picker;
+    mutable std::unique_ptr<ImageGrabber> _grabber;
+    std::unique_ptr<ActorCache> _cache;
+    size_t _nthreads;
     RendererPicker *picker() const;
+    ImageGrabber *grabber() const;
 
     OffscreenModelViewer( const OffscreenModelViewer&) = delete;
     void operator=( const OffscreenModelViewer&) = delete;
@@ -0,0 +1,45 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_PARALLEL_CHUNKS_H
+#define RVTK_PARALLEL_CHUNKS_H
+
+#include "rVTK_Export.h"
+#include <functional>
+#include <cstddef>
+
+namespace RVTK {
+
+// Function called for each chunk of a range with the chunk index and the [begin,end) sub-range.
+using ChunkFn = std::function<void(size_t chunk, size_t begin, size_t end)>;
+
+// Returns the number of threads used for parallel operations when not otherwise specified
+// (the hardware concurrency, or 1 if that can't be determined).
+rVTK_EXPORT size_t defaultThreadCount();
+
+// Returns the number of chunks parallelChunks will split the range [0,n) into given the requested
+// maximum number of threads (0 for defaultThreadCount) and the minimum number of elements per chunk.
+rVTK_EXPORT size_t numChunks( size_t n, size_t nthreads=0, size_t minChunk=1);
+
+// Split the range [0,n) into numChunks( n, nthreads, minChunk) contiguous chunks of near equal size
+// and call fn on each in its own thread, with the calling thread processing the first chunk.
+// Returns once all chunks are processed, giving the number of chunks used.
+rVTK_EXPORT size_t parallelChunks( size_t n, const ChunkFn& fn, size_t nthreads=0, size_t minChunk=1);
+
+}   // end namespace
+
+#endif
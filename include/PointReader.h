@@ -20,7 +20,14 @@
  * a single point per line. Each line should be in the format:
  * X Y Z R G B
  * Where X,Y,Z are the coordinates of the point along those axes and
- * R,G,B are the pixel intensity values for those colours.
+ * R,G,B are the pixel intensity values for those colours (0-255).
+ * If R,G,B are absent, the point is coloured white. Lines not starting
+ * with a number (e.g. headers or comments) are ignored.
+ *
+ * The file is memory mapped and parsed in parallel chunks straight into
+ * float point and unsigned char colour arrays. Pieces are supported so
+ * very large files can be read progressively by requesting one piece of
+ * the file at a time (each piece is a contiguous range of lines).
  *
  * Richard Palmer
  * June 2011
@@ -31,16 +38,17 @@
 #define RVTK_POINT_READER_H
 
 #include "VTKTypes.h"
+#include <vtkPolyDataAlgorithm.h>
 
 namespace RVTK
 {
 
-class VTK_IO_EXPORT PointReader : public vtkPolyDataAlgorithm
+class rVTK_EXPORT PointReader : public vtkPolyDataAlgorithm
 {
 public:
    static PointReader* New();
-   vtkTypeRevisionMacro( PointReader, vtkPolyDataAlgorithm);
-   void PrintSelf( ostream& os, vtkIndent indent);
+   vtkTypeMacro( PointReader, vtkPolyDataAlgorithm);
+   void PrintSelf( ostream& os, vtkIndent indent) override;
 
    /**
     * Set/Get the name of the file from which to read points.
@@ -48,18 +56,33 @@ public:
    vtkSetStringMacro(FileName);
    vtkGetStringMacro(FileName);
 
+   /**
+    * Set/Get whether a vertex cell is made for every point so the points render (default on).
+    */
+   vtkSetMacro( GenerateVertices, bool);
+   vtkGetMacro( GenerateVertices, bool);
+   vtkBooleanMacro( GenerateVertices, bool);
+
+   /**
+    * Set/Get the number of parsing threads (0 for the number of hardware threads; the default).
+    */
+   vtkSetMacro( NumberOfThreads, int);
+   vtkGetMacro( NumberOfThreads, int);
+
 protected:
    PointReader();
-   ~PointReader();
+   ~PointReader() override;
 
-   string filename;
+   char* FileName;
+   bool GenerateVertices;
+   int NumberOfThreads;
 
-   int RequestData( vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+   int RequestInformation( vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+   int RequestData( vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
 
 private:
-   // Copy construction not implemented
-   PointReader( const PointReader&);
-   void operator=( const PointReader&)
+   PointReader( const PointReader&) = delete;
+   void operator=( const PointReader&) = delete;
 }; // end class
 
 }   // end namespace
@@ -0,0 +1,106 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_RAY_CASTER_H
+#define RVTK_RAY_CASTER_H
+
+#include "rVTK_Export.h"
+#include <ObjModel.h>       // RFeatures
+#include <CameraParams.h>   // RFeatures
+#include <vtkActor.h>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace RVTK {
+
+// The result of casting a single ray. If nothing was hit, cellId is -1.
+struct rVTK_EXPORT RayHit
+{
+    RayHit() : actor(nullptr), cellId(-1), pos(0,0,0), normal(0,0,0) {}
+    vtkActor* actor;    // The actor given when the hit geometry was added (may be null)
+    int cellId;         // Face ID (ObjModel) or cell ID (vtkPolyData) of the hit triangle
+    cv::Vec3f pos;      // World position of the hit
+    cv::Vec3f normal;   // Unit normal of the hit triangle (following its vertex ordering)
+};  // end struct
+
+
+// Picking on the CPU by casting rays against a bounding volume hierarchy of triangles.
+// Unlike RendererPicker, no renderer or rendered frame is needed so this can be used
+// for batch 2D to 3D queries in headless jobs. Once built, casting is thread safe.
+class rVTK_EXPORT RayCaster
+{
+public:
+    RayCaster();
+
+    // Add the triangles of the given model (which must have sequential vertex/face IDs)
+    // transformed by its transformMatrix. Hits report the face ID as the cell ID and the
+    // given actor (e.g. the actor created for the model by VtkActorCreator).
+    void add( const RFeatures::ObjModel&, vtkActor* actor=nullptr);
+
+    // Add the polygons of the actor's polydata transformed by the actor's matrix.
+    // Polygons with more than three vertices are fanned into triangles.
+    void add( vtkActor*);
+
+    // Remove all added geometry.
+    void clear();
+
+    // Build the hierarchy over the geometry added so far. Called automatically on casting
+    // if geometry has been added since the last build, but must be called explicitly
+    // before casting from multiple threads.
+    void build();
+
+    // Cast a single ray from origin in the given direction returning the nearest hit.
+    RayHit cast( const cv::Vec3f& origin, const cv::Vec3f& dir) const;
+
+    // Cast rays through the given points of the image plane seen by a camera (perspective
+    // projection with vertical field of view cp.fov in degrees, as for VTK) for an image of
+    // the given size. Points are given as proportions of the image dimensions with a top left
+    // origin (as for OffscreenModelViewer). Queries are shared over nthreads (0 for the default).
+    // On return, hits has an entry per point. Returns the number of points that hit something.
+    size_t cast( const RFeatures::CameraParams&, const cv::Size&, const std::vector<cv::Point2f>&,
+                 std::vector<RayHit>& hits, size_t nthreads=0) const;
+
+    size_t numTriangles() const { return _tris.size();}
+
+private:
+    struct Triangle
+    {
+        cv::Vec3f v0, e1, e2;   // First vertex and edges to the second and third
+        int mesh;               // Index into _actors
+        int cellId;
+    };  // end struct
+
+    struct Node
+    {
+        cv::Vec3f bmin, bmax;
+        int first;  // Index of left child (right is left+1) if count is 0, else index of first triangle
+        int count;  // Number of triangles if a leaf
+    };  // end struct
+
+    std::vector<Triangle> _tris;
+    std::vector<Node> _nodes;
+    std::vector<vtkActor*> _actors;
+    bool _dirty;
+
+    void addTriangle( const cv::Vec3f&, const cv::Vec3f&, const cv::Vec3f&, int mesh, int cellId);
+    void buildNode( int, std::vector<int>&, const std::vector<cv::Vec3f>&, int, int);
+    RayHit castBuilt( const cv::Vec3f&, const cv::Vec3f&) const;
+};  // end class
+
+}   // end namespace
+
+#endif
@@ -0,0 +1,72 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_RENDER_POOL_H
+#define RVTK_RENDER_POOL_H
+
+#include "OffscreenModelViewer.h"
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <deque>
+
+namespace RVTK {
+
+// A pool of offscreen render contexts each owned by its own thread. Each thread creates
+// its own OffscreenModelViewer (and so its own OpenGL context) which is only ever used
+// from that thread. Jobs are queued and taken by whichever context is free next. For
+// rendering without a display, VTK must be built for headless rendering (OSMesa or EGL).
+// Each context processes its images on its own thread only (see OffscreenModelViewer::setThreadCount).
+class rVTK_EXPORT RenderPool
+{
+public:
+    // Create n render contexts (0 for defaultThreadCount) with viewers of the given
+    // dimensions and initial camera range (see OffscreenModelViewer).
+    RenderPool( const cv::Size& dims, size_t n=0, float rng=500);
+
+    // Waits for all queued jobs to finish before returning.
+    ~RenderPool();
+
+    // Queue rendering of the given model from each of the given cameras. The model must
+    // not be modified until the returned future is ready.
+    std::future<std::vector<ViewImages> > submit( const RFeatures::ObjModel::Ptr,
+                                                  const std::vector<RFeatures::CameraParams>&);
+
+    size_t size() const { return _threads.size();}   // Number of render contexts
+    size_t pending() const; // Number of jobs waiting for a context
+
+private:
+    using Job = std::function<void(OffscreenModelViewer&)>;
+    const cv::Size _dims;
+    const float _rng;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop;
+
+    void run();
+
+    RenderPool( const RenderPool&) = delete;
+    void operator=( const RenderPool&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
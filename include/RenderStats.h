@@ -0,0 +1,91 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_RENDER_STATS_H
+#define RVTK_RENDER_STATS_H
+
+#include "rVTK_Export.h"
+#include <vtkRenderer.h>
+#include <unordered_map>
+#include <iostream>
+#include <chrono>
+#include <deque>
+
+namespace RVTK {
+
+// Statistics for a single rendered frame. Times are in milliseconds.
+struct rVTK_EXPORT FrameStats
+{
+    double startMs;         // Frame start since the stats were created (or cleared)
+    double wallMs;          // Wall time of the whole render
+    double renderMs;        // The renderer's own time for the render as reported by VTK
+    double readbackMs;      // Time reading back buffers after the frame (zero if none)
+    size_t triangles;       // Polygons in the visible actors
+    size_t points;          // Points in the visible actors
+    size_t meshUpdates;     // Visible actors with geometry changed since the previous frame (mapper rebuilds)
+    size_t textureUpdates;  // Visible actors with texture changed since the previous frame (texture uploads)
+};  // end struct
+
+
+// Records statistics over a rolling window of the most recent frames. Frames are delimited
+// by calls to beginFrame and endFrame (Viewer makes these from its render window's start and
+// end render events when its stats are enabled).
+class rVTK_EXPORT RenderStats
+{
+public:
+    explicit RenderStats( size_t window=300);
+
+    void beginFrame();
+    void endFrame( vtkRenderer*);   // Counts and change tracking are over the renderer's visible actors
+
+    // Add time spent reading back buffers to the last frame (shown following the frame in traces).
+    void addReadback( double ms);
+
+    double now() const;     // Milliseconds since the stats were created (or cleared)
+
+    void setWindow( size_t);
+    size_t window() const { return _window;}
+
+    size_t totalFrames() const { return _total;}    // All frames recorded (including those no longer in the window)
+    const std::deque<FrameStats>& frames() const { return _frames;}  // Frames in the window, oldest first
+
+    // Return the value at the given percentile [0,100] of the given field over the frames in the window.
+    // E.g. percentile( 95, &FrameStats::wallMs). Returns zero if there are no frames.
+    double percentile( double p, double FrameStats::* field) const;
+
+    // Write a JSON object with p50/p95/p99 summaries of the time fields and the frames in the window.
+    void writeJSON( std::ostream&) const;
+
+    // Write the frames in the window as Chrome trace events (load in chrome://tracing or Perfetto).
+    void writeTrace( std::ostream&) const;
+
+    void clear();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    size_t _window;
+    size_t _total;
+    Clock::time_point _t0;
+    double _frameStart;
+    std::deque<FrameStats> _frames;
+    std::unordered_map<const void*, vtkMTimeType> _meshTimes;
+    std::unordered_map<const void*, vtkMTimeType> _textureTimes;
+};  // end class
+
+}   // end namespace
+
+#endif
@@ -19,10 +19,17 @@
 #define RVTK_RENDERER_PICKER_H
 
 #include <vector>
+#include <unordered_map>
 #include <opencv2/opencv.hpp>
 #include <vtkSmartPointer.h>
 #include <vtkRenderer.h>
 #include <vtkActor.h>
+#include <vtkPolyData.h>
+#include <vtkCellPicker.h>
+#include <vtkPropPicker.h>
+#include <vtkWorldPointPicker.h>
+#include <vtkModifiedBSPTree.h>
+#include <vtkWeakPointer.h>
 #include "rVTK_Export.h"
 
 namespace RVTK {
@@ -48,6 +55,10 @@ public:
     // Use the PointOrigin parameter to let the picking algorithms know if the provided
     // points are given with a bottom left origin (VTK default) or a top left origin.
     // Calls ResetCameraClippingRange() on the provided vtkRenderer to ensure picking accuracy.
+    // The pickers are kept for the lifetime of this object, and cell picking is accelerated
+    // using a cell locator (vtkModifiedBSPTree) per polydata actor in the renderer. Locators are
+    // built on first use and cached, being rebuilt only when an actor's polydata are modified.
+    // The pickers' locators are only updated when props are added or removed or polydata change.
     RendererPicker( vtkRenderer*, PointOrigin po=BOTTOM_LEFT, double tolerance=0.0005);
 
     // Given array of 2D pixel coordinates, find the actors and their cell IDs
@@ -62,6 +73,18 @@ public:
                         vtkActor* actor,
                         std::vector<int>& cellIds) const;
 
+    // Batched equivalents of the above two functions for large numbers of points. Rather than
+    // casting rays for every point, the scene is rendered once into actor and cell ID buffers
+    // (using vtkHardwareSelector) over the bounding rectangle of the given points and each point
+    // is then answered by lookup. Only visible cells are picked. For the single actor version,
+    // other props are made temporarily unpickable so they don't occlude the given actor.
+    // Returns -1 if the ID buffers could not be captured (e.g. no OpenGL context available).
+    int pickActorCellsBatched( const std::vector<cv::Point>& points2d,
+                               std::vector<ActorSubset>& picked) const;
+    int pickActorCellsBatched( const std::vector<cv::Point>& points2d,
+                               vtkActor* actor,
+                               std::vector<int>& cellIds) const;
+
     // Given a 2D point, find the actor being pointed to. Returns null if no actor found.
     vtkActor* pickActor( const cv::Point&) const;
     vtkActor* pickActor( const cv::Point2f&) const;
@@ -80,7 +103,8 @@ public:
     cv::Vec3f pickWorldPosition( const cv::Point2f&) const;
 
     // Pick the normal vector to the surface at the given point.
-    // If no 3D point intersects, return the zero vector.
+    // If no 3D point intersects, return the zero vector. Unlike the cell picks, this always
+    // uses vtkCellPicker's default tolerance rather than the one given to the constructor.
     cv::Vec3f pickNormal( const cv::Point&) const;
     cv::Vec3f pickNormal( const cv::Point2f&) const;
 
@@ -88,11 +112,32 @@ public:
     // the coordinates origin set in the constructor.
     cv::Point projectToImagePlane( const cv::Vec3f& v) const;
 
+    // Discard all cached cell locators (they are rebuilt as needed on the next pick).
+    void clearLocators();
+
 private:
     vtkRenderer* _ren;
     const PointOrigin _pointOrigin;
     const double _tolerance;
+    vtkSmartPointer<vtkCellPicker> _cellPicker;
+    vtkSmartPointer<vtkCellPicker> _normalPicker;
+    vtkSmartPointer<vtkPropPicker> _propPicker;
+    vtkSmartPointer<vtkWorldPointPicker> _worldPicker;
+
+    struct CellLocator
+    {
+        vtkWeakPointer<vtkActor> actor;         // Null once the actor is deleted
+        vtkWeakPointer<vtkPolyData> pd;         // The actor's polydata when last checked
+        vtkSmartPointer<vtkModifiedBSPTree> tree;   // Null if the polydata has no cells
+        vtkMTimeType buildTime;
+    };  // end struct
+    mutable std::unordered_map<vtkActor*, CellLocator> _locators;
+    mutable vtkMTimeType _propsMTime;   // Of the renderer's view props when the locators were updated
+
     cv::Point toPxls( const cv::Point2f&) const;
+    bool locatorsChanged() const;
+    vtkCellPicker* cellPicker() const;
+    vtkCellPicker* normalPicker() const;
 };  // end class
 
 }   // end namespace
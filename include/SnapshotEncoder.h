@@ -0,0 +1,105 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef RVTK_SNAPSHOT_ENCODER_H
+#define RVTK_SNAPSHOT_ENCODER_H
+
+#include "rVTK_Export.h"
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <string>
+
+namespace RVTK {
+
+// Encodes and writes images on a pool of background threads so capturing frames doesn't block
+// the caller. Queued frames are bounded; frames offered while the queue is full are dropped (and
+// counted) rather than stalling the caller. Frames can be written as individual image files (any
+// format cv::imwrite supports) or appended in order to a video file.
+class rVTK_EXPORT SnapshotEncoder
+{
+public:
+    // Create n encoding threads (0 for defaultThreadCount) with at most maxQueued frames waiting.
+    explicit SnapshotEncoder( size_t n=0, size_t maxQueued=32);
+
+    // Waits for all queued frames to be written before returning.
+    ~SnapshotEncoder();
+
+    // Queue the image to be written to the given file. The image data are not copied so the image
+    // must not be modified after being passed in (pass a clone if necessary). Returns false if the
+    // frame was dropped because the queue was full.
+    bool write( const cv::Mat& img, const std::string& fname);
+
+    // Open a video file to which frames given to writeFrame are appended in the order given.
+    // Any currently open video is closed first (after its queued frames are written).
+    // Returns false if the video could not be opened.
+    bool openVideo( const std::string& fname, double fps, const cv::Size&, int fourcc=cv::VideoWriter::fourcc('M','J','P','G'));
+    void closeVideo();  // Waits for queued frames to be written then closes the video.
+    bool isVideoOpen() const;
+
+    // Queue the image to be appended to the open video (must be the size given to openVideo;
+    // frames of other sizes are counted as failed). Returns false if no video is open or the
+    // frame was dropped because the queue was full.
+    bool writeFrame( const cv::Mat& img);
+
+    void flush();   // Wait for all queued frames to be written.
+
+    size_t queued() const;      // Number of frames currently waiting
+    size_t maxQueued() const;   // The most frames ever waiting at once
+    size_t written() const;     // Number of frames written
+    size_t dropped() const;     // Number of frames dropped because the queue was full
+    size_t failed() const;      // Number of frames that failed to write (or threw while writing)
+    void resetStats();
+
+private:
+    struct Job
+    {
+        cv::Mat img;
+        std::string fname;  // Empty for video frames
+        size_t seq;         // Order of video frames
+    };  // end struct
+
+    const size_t _maxQueue;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;        // Signalled when jobs are queued
+    std::condition_variable _doneCv;    // Signalled when jobs complete
+    bool _stop;
+    size_t _active;     // Number of jobs being written
+    size_t _maxDepth, _written, _dropped, _failed;
+
+    bool _videoOpen;
+    size_t _nextSeq;    // Sequence number of the next video frame to queue
+    cv::VideoWriter _video;
+    cv::Size _videoSize;
+    std::mutex _videoMutex; // Guards the video writer separately so writing doesn't block queueing
+    std::condition_variable _videoCv;
+    size_t _videoSeq;   // Sequence number of the next video frame to write
+
+    bool enqueue( Job&&);
+    void run();
+
+    SnapshotEncoder( const SnapshotEncoder&) = delete;
+    void operator=( const SnapshotEncoder&) = delete;
+};  // end class
+
+}   // end namespace
+
+#endif
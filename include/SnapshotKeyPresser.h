@@ -21,6 +21,10 @@
 #include <opencv2/opencv.hpp>
 #include "Viewer.h"
 #include "KeyPresser.h"
+#include "FrameCapture.h"
+#include "SnapshotEncoder.h"
+#include <vtkCallbackCommand.h>
+#include <memory>
 
 
 namespace RVTK {
@@ -34,12 +38,24 @@ public:
             const cv::Vec3d& camPos, const cv::Vec3d& focalDir, const cv::Vec3d& vUp, float fov);
 
     virtual bool handleKeyPress( const string& keySym);
-    virtual ~SnapshotKeyPresser() {}
+    virtual ~SnapshotKeyPresser();
 
     virtual void printUsage( std::ostream&) const;
 
     void setImage( const cv::Mat&);
 
+    // Set the video file that recording writes to (at the given frames per second). If not set
+    // (or set empty) recording writes a numbered JPEG sequence (frame_<n>.jpg) instead.
+    void setRecordVideo( const std::string& fname, double fps=25);
+
+    // Start/stop recording every rendered frame. Frames are captured on render and handed
+    // to a background encoder so interaction isn't blocked; frames arriving when the encoder's
+    // queue is full are dropped. Stopping prints the recording statistics.
+    void setRecording( bool);
+    bool isRecording() const { return _recording;}
+
+    const SnapshotEncoder& encoder() const { return *_encoder;}   // For queue and drop statistics
+
 protected:
     SnapshotKeyPresser( RVTK::Viewer::Ptr v,
             const cv::Vec3d& camPos, const cv::Vec3d& focalDir, const cv::Vec3d& vUp, float fov);
@@ -52,6 +68,17 @@ private:
     mutable int _snapCount; // Snapshot counter for images saved from the rendering buffer
     cv::Mat _image; // Image to display
     bool _showingImage; // True if showing image
+    std::unique_ptr<SnapshotEncoder> _encoder;
+    FrameCapture _capture;
+    vtkSmartPointer<vtkCallbackCommand> _renderCallback;
+    unsigned long _observerTag;
+    bool _recording;
+    size_t _frameCount;
+    std::string _videoFile;
+    double _videoFps;
+
+    static void onRender( vtkObject*, unsigned long, void*, void*);
+    void recordFrame();
 
     void resetCamera(); // Reset to front
     void addCameraYaw( float yaw);
@@ -21,7 +21,11 @@
 #include "rVTK_Export.h"
 #include <ObjModel.h>   // RFeatures
 #include <vtkActor.h>
+#include <vtkPolyData.h>
+#include <vtkDataArray.h>
+#include <vtkWeakPointer.h>
 #include <functional>
+#include <vector>
 
 namespace RVTK {
 
@@ -29,6 +33,10 @@ namespace RVTK {
 // k (always 0 for scalars but up to 1 less than dimensionality for vector metrics).
 using MetricFn = std::function<float(int id, size_t k)>;
 
+// Get metrics for the n consecutive polygon or vertex IDs starting at id, writing all components
+// of each ID's metric in turn to out (so out[i*dims + k] is component k for ID id+i).
+using BatchMetricFn = std::function<void(int id, int n, float* out)>;
+
 class rVTK_EXPORT SurfaceMapper
 {
 public:
@@ -37,6 +45,7 @@ public:
     // Set dims to 1 for mapping scalars (default), higher values for mapping vectors.
     using CPtr = std::shared_ptr<const SurfaceMapper>;
     static CPtr create( const std::string&, const MetricFn&, bool mapPolys=true, size_t dims=1);
+    static CPtr create( const std::string&, const BatchMetricFn&, bool mapPolys=true, size_t dims=1);
 
     inline const std::string& label() const { return _label;}
     inline bool mapsPolys() const { return _mapsPolys;}
@@ -53,22 +62,49 @@ public:
     // actor->GetProperty()->SetRepresentationToSurface() (obviously)
     // actor->GetMapper()->SetScalarModelToUseCellData() (may not be needed)
     // actor->GetMapper()->SetScalarVisibility(true)
-    void mapMetrics( const RFeatures::ObjModel&, vtkActor*) const;
+    // Metrics are evaluated once per polygon/vertex into a dense buffer before being copied to
+    // any points duplicated for texture mapping. Set nthreads to evaluate metrics in parallel
+    // chunks over that many threads (0 for the default number) in which case the metric
+    // function must be safe to call concurrently.
+    void mapMetrics( const RFeatures::ObjModel&, vtkActor*, size_t nthreads=1) const;
+
+    // Update the metrics for just the given polygon or vertex IDs in the array previously added
+    // to the actor by mapMetrics, including all points duplicated for texture mapping. Values are
+    // rewritten in place (no new array is created) and the min/max values are updated incrementally
+    // (only rescanning a component's values if a previous extreme value was moved inwards). The
+    // min/max are first rescanned from the actor's array if it isn't the array mapMetrics or
+    // updateMetrics was last called with (or it has been modified since).
+    // Where vertex metrics are copied to duplicated points, a reverse index from vertices to
+    // points is built on first use and reused until the actor's points change.
+    // Returns the number of tuples rewritten or 0 if mapMetrics hasn't been called on the actor.
+    size_t updateMetrics( const RFeatures::ObjModel&, vtkActor*, const IntSet& ids) const;
 
-    // Get min/max for component c from last call to mapActor.
+    // Get min/max for component c of the array from the last call to mapMetrics or updateMetrics.
     float getMin( int c=0) const { return _min[c];}
     float getMax( int c=0) const { return _max[c];}
 
 private:
     const std::string _label;
-    MetricFn _metricfn;
+    BatchMetricFn _metricfn;
     const bool _mapsPolys;
     const size_t _ndims;
     mutable std::vector<float> _min;
     mutable std::vector<float> _max;
-    float val( int, size_t) const;
+    mutable vtkWeakPointer<vtkDataArray> _rangeArray;    // The array _min/_max are for
+    mutable vtkMTimeType _rangeMTime = 0;                // Of _rangeArray when _min/_max were found
+
+    // Model vertex to actor points reverse index (compressed rows) cached for updateMetrics.
+    struct PointIndex
+    {
+        const vtkPolyData* pd = nullptr;
+        vtkMTimeType mtime = 0;
+        std::vector<int> offs;  // Vertex v's points are pids[offs[v]] to pids[offs[v+1]-1]
+        std::vector<int> pids;
+    };  // end struct
+    mutable PointIndex _pointIndex;
+    const PointIndex& pointIndex( vtkActor*, const RFeatures::ObjModel&, const int* pvids) const;
 
-    SurfaceMapper( const std::string&, const MetricFn&, bool mapPolys, size_t dims);
+    SurfaceMapper( const std::string&, const BatchMetricFn&, bool mapPolys, size_t dims);
     ~SurfaceMapper(){}
     SurfaceMapper( const SurfaceMapper&) = delete;
     void operator=( const SurfaceMapper&) = delete;
@@ -26,6 +26,8 @@
 #define RVTK_VIEWER_H
 
 #include "VTKTypes.h"
+#include "RenderStats.h"
+#include <vtkCallbackCommand.h>
 #include <CameraParams.h>   // RFeatures
 #include <memory>
 #include <opencv2/opencv.hpp>
@@ -38,6 +40,7 @@ public:
     typedef std::shared_ptr<Viewer> Ptr;
     static Ptr create( bool offscreenRendering=false);
     Viewer( bool offscreenRendering=false);
+    ~Viewer();
 
     // Add the provided actor. If this is the first actor,
     // subsequent actors will be placed relative to it.
@@ -99,9 +102,28 @@ public:
     // Extract Z buffer - ensure camera clipping range is set properly prior to using!
     cv::Mat_<float> extractZBuffer() const;
 
+    // Extract the Z buffer as linear eye-space depth in world units (zero for background pixels).
+    cv::Mat_<float> extractLinearDepth() const;
+
+    // Extract the world position of the surface at each pixel (NaN for background pixels),
+    // optionally also setting the linear depth map from the same unprojection pass.
+    cv::Mat_<cv::Vec3f> extractPointMap( cv::Mat_<float>* edepth=nullptr) const;
+
+    // Opt-in frame timing and render statistics over a rolling window of the given number of frames.
+    // Every render of the window is recorded (including those made by an interactor) along with the
+    // time spent reading back buffers in extractImage and extractZBuffer and by any FrameCapture (and so
+    // ImageGrabber) made from this viewer. Disabling discards the stats.
+    void setStatsEnabled( bool enable, size_t window=300);
+    const RenderStats* stats() const { return _stats.get();}    // Null if not enabled
+    RenderStats* stats() { return _stats.get();}
+
 private:
     vtkNew<vtkRenderer> _ren;
     vtkNew<vtkRenderWindow> _renWin;
+    std::unique_ptr<RenderStats> _stats;
+    vtkSmartPointer<vtkCallbackCommand> _statsCallback;
+    unsigned long _startTag, _endTag;
+    static void onRenderEvent( vtkObject*, unsigned long, void*, void*);
 
     Viewer( const Viewer&) = delete;
     void operator=( const Viewer&) = delete;
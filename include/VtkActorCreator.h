@@ -22,26 +22,58 @@
 #include "rVTK_Export.h"
 #include <vtkSmartPointer.h>
 #include <vtkActor.h>
+#include <functional>
 #include <vector>
 #include <list>
+#include <string>
 
 namespace RVTK {
 
 class rVTK_EXPORT VtkActorCreator
 {
 public:
+    // Called between the stages of actor creation with the proportion [0,1] of creation done.
+    // Return false to stop creation (in which case null is returned).
+    using StageFn = std::function<bool(float)>;
+
     // Return a texture mapped actor for the given model as long as only a single material is defined.
     // If no materials are defined, this function is equivalent to calling generateSurfaceActor.
     // The provided model must have all its vertex/face IDs in sequential order so they can
     // be treated as indices. On return, lighting is set to 100% ambient, 0% diffuse and 0% specular
     // so that the texture is lit properly. Returns null if more than one material defined on the object.
     // On return, the internal matrix of the actor will match ObjModel::transformMatrix.
-    static vtkSmartPointer<vtkActor> generateActor( const RFeatures::ObjModel&);
+    // By default, every triangle is given its own three points (3 x numPolys points in total).
+    // Set shareVertices to true to only split a vertex into separate points where the faces
+    // using it map it to different texture coordinates. Actors created this way have a point
+    // data array named VERTEX_IDS_ARRAY (vtkIntArray) giving the model vertex of each point.
+    // Normals are generated with vtkPolyDataNormals (see RVTK::generateNormals) unless fastNormals
+    // or shareVertices is true in which case the faster RVTK::calcVertexNormals is used. This assumes
+    // consistently ordered polygons and never splits along sharp edges so shading may differ.
+    // If given, stage is called after the polydata is built, after normals are calculated and
+    // after the texture is converted.
+    static vtkSmartPointer<vtkActor> generateActor( const RFeatures::ObjModel&, bool shareVertices=false,
+                                                    bool fastNormals=false, const StageFn& stage=nullptr);
+
+    // Generate texture mapped actors for a model having any number of materials, appending one actor per
+    // material (in material ID order) to the given vector and returning the number appended. The actors
+    // share the same points, normals and texture coordinates with each having only its own material's
+    // faces and texture, so no merging of materials is needed beforehand. Any faces without a material
+    // are given an untextured actor. Lighting, shareVertices and fastNormals are as for generateActor.
+    // If no materials are defined, a single surface actor is appended (as for generateSurfaceActor).
+    // Returns 0 (and appends nothing) if the model's vertex/face IDs are not in sequential order.
+    static size_t generateActors( const RFeatures::ObjModel&, std::vector<vtkSmartPointer<vtkActor> >&,
+                                  bool shareVertices=false, bool fastNormals=false);
+
+    // Name of the point data array mapping actor points to model vertex IDs (see generateActor).
+    static const std::string VERTEX_IDS_ARRAY;
 
     // Returns a non-textured actor for the given model. Model must have all its vertex/face IDs
     // stored in sequential order so they can be treated as indices.
     // On return, the internal matrix of the actor will match ObjModel::transformMatrix.
-    static vtkSmartPointer<vtkActor> generateSurfaceActor( const RFeatures::ObjModel&);
+    // Normals are generated as for generateActor (fastNormals is opt-in). If given, stage is called
+    // after the polydata is built and after normals are calculated.
+    static vtkSmartPointer<vtkActor> generateSurfaceActor( const RFeatures::ObjModel&, bool fastNormals=false,
+                                                           const StageFn& stage=nullptr);
 
     // Generate a simple points actor.
     // On return, the actor's internal matrix will match ObjModel::transformMatrix.
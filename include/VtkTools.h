@@ -64,6 +64,8 @@ rVTK_EXPORT vtkSmartPointer<vtkImageImport> makeImageImporter( const cv::Mat img
 // If image flipping is not needed (because the texture coords use the
 // top left as origin), ensure XFLIP is set to false.
 // For CV_8UC3 images, byte order colours should be BGR (normal OpenCV style).
+// The image need not be continuous; its pixels are copied once into the
+// texture's input image data so it may be released after this returns.
 rVTK_EXPORT vtkSmartPointer<vtkTexture> convertToTexture( const cv::Mat& img, bool XFLIP=true);
 rVTK_EXPORT vtkSmartPointer<vtkTexture> loadTexture( const std::string& fname, bool XFLIP=true);
 
@@ -80,12 +82,65 @@ rVTK_EXPORT void print( std::ostream&, const vtkMatrix4x4*);
 rVTK_EXPORT void extractBoundaryVertices( const vtkSmartPointer<vtkPolyData>& pdata, std::vector<int>& pts);
 
 // Generate a set of normals from a vtkPolyData object having point and cell data.
-rVTK_EXPORT vtkSmartPointer<vtkPolyData> generateNormals( vtkSmartPointer<vtkPolyData> pdata);
+// Set consistency to false to skip reordering polygons to have consistent orientation (only do
+// this if the polygon ordering is already known to be consistent). Set splitting to false to
+// stop vertices being split along sharp edges (splitting changes the number of points).
+rVTK_EXPORT vtkSmartPointer<vtkPolyData> generateNormals( vtkSmartPointer<vtkPolyData> pdata,
+                                                          bool consistency=true, bool splitting=true);
+
+// Calculate per vertex normals directly over the model's indexed triangles (without going through
+// vtkPolyDataNormals) as the normalised sum of the unit normals of the faces using each vertex.
+// Face normals are found in parallel over chunks of faces and then gathered per vertex in parallel
+// over chunks of vertices (nthreads, 0 for the default) so memory use does not grow with thread count.
+// Cross products and sums use SSE2 (one xyz0 register per vector) where available. Results don't
+// depend on the number of threads.
+// Polygon ordering is taken to be consistent and vertices are never split so on return vnrms
+// has one normal per model vertex. This matches generateNormals with consistency and splitting
+// both off (to within float rounding) but NOT the defaults, which may flip and split along sharp edges.
+// The model must have sequential vertex and face IDs.
+rVTK_EXPORT void calcVertexNormals( const RFeatures::ObjModel&, std::vector<cv::Vec3f>& vnrms, size_t nthreads=0);
 
 // Dump a colour or Z buffer image from the provided render window.
+// For repeated captures from the same window, use a FrameCapture instead.
 rVTK_EXPORT cv::Mat_<cv::Vec3b> extractImage( const vtkRenderWindow*);
 rVTK_EXPORT cv::Mat_<float> extractZBuffer( const vtkRenderWindow*);
 
+// Unproject a Z-buffer image (top row first, as returned by extractZBuffer) through the given
+// camera (with the aspect ratio of the viewport it was rendered in) in one parallel pass.
+// If edepth is not null, it's set to the linear eye-space depth in world units along the view
+// direction. If points is not null, it's set to the world position of the surface at each pixel.
+// The Z-buffer image covers the whole render window with the camera's renderer drawn in viewport vp
+// (as from vtkRenderer::GetViewport: xmin, ymin, xmax, ymax normalised with a bottom left origin).
+// The Z-buffer may have been resized since every pixel centre is mapped proportionally into the
+// viewport, but only with nearest neighbour sampling (interpolated values make points floating between
+// surfaces). The unprojection is done in double precision with only the outputs stored as float.
+// Background pixels (Z-buffer value of 1) and pixels outside the viewport have depth zero and NaN points.
+rVTK_EXPORT void unprojectZBuffer( vtkCamera*, double aspect, const cv::Mat_<float>& zbuff,
+                                   cv::Mat_<float>* edepth, cv::Mat_<cv::Vec3f>* points, size_t nthreads=0,
+                                   const cv::Vec4d& vp=cv::Vec4d(0,0,1,1));
+
+// Make a byte map from a Z-buffer image with the nearest depth mapped to 255 and the depth at
+// proportion depthProp of the way from the nearest to furthest depth mapped to 0 (any further
+// is saturated to 0). Equivalent to subtracting the minimum and calling convertTo but done in
+// two parallel sweeps (min/max then write, each with OpenCV's vectorised minMaxIdx and convertTo
+// over the rows of a chunk) with no temporary copy of the Z-buffer. The sweeps are split over at
+// most nthreads threads (0 for the default).
+rVTK_EXPORT void makeDepthByteMap( const cv::Mat_<float>& zbuff, cv::Mat_<unsigned char>& dmap,
+                                   float depthProp=1.0f, size_t nthreads=0);
+
+// Set lmap to the CIE-L (lightness) component of the given BGR image contrast stretched over [0,255].
+// Lightness is found by lookup (without a full colour conversion) with the range found in the
+// same sweep so the stretch needs only one more sweep (in place on lmap) over at most nthreads
+// threads (0 for the default).
+rVTK_EXPORT void makeStretchedLightness( const cv::Mat_<cv::Vec3b>& img, cv::Mat_<unsigned char>& lmap, size_t nthreads=0);
+
+// Make both of the above from a colour image and Z-buffer of the same size (as from a single render)
+// with the two range finding sweeps fused into one pass over the rows and the two writing sweeps
+// (lightness stretch and depth bytes) fused into another.
+rVTK_EXPORT void makeLightnessAndDepthMaps( const cv::Mat_<cv::Vec3b>& img, const cv::Mat_<float>& zbuff,
+                                            cv::Mat_<unsigned char>& lmap, cv::Mat_<unsigned char>& dmap,
+                                            float depthProp=1.0f, size_t nthreads=0);
+
 rVTK_EXPORT void printCameraDetails( vtkCamera*, std::ostream&);    // Print camera details to the given stream
 
 // Replace the lights in the given renderer with the given lights.
@@ -0,0 +1,170 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <ActorCache.h>
+#include <VtkTools.h>
+#include <vtkTexture.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+#include <cstdint>
+#include <cstring>
+using RVTK::ActorCache;
+using RFeatures::ObjModel;
+
+
+namespace {
+
+// FNV-1a style hash over raw bytes taking eight bytes at a time (tail bytes singly).
+void hashBytes( size_t& h, const void* data, size_t n)
+{
+    const unsigned char* b = static_cast<const unsigned char*>(data);
+    uint64_t w;
+    for ( ; n >= sizeof(w); n -= sizeof(w), b += sizeof(w))
+    {
+        std::memcpy( &w, b, sizeof(w));
+        h ^= size_t(w);
+        h *= size_t(1099511628211ULL);
+    }   // end for
+    for ( ; n > 0; --n, ++b)
+    {
+        h ^= *b;
+        h *= size_t(1099511628211ULL);
+    }   // end for
+}   // end hashBytes
+
+}   // end namespace
+
+
+ActorCache::ActorCache( size_t budget)
+    : _budget(budget), _bytes(0), _hits(0), _misses(0), _evictions(0) {}
+
+
+size_t ActorCache::hash( const ObjModel& model)
+{
+    size_t h = size_t(14695981039346656037ULL);
+    const int nv = model.numVtxs();
+    const int nf = model.numPolys();
+    hashBytes( h, &nv, sizeof(int));
+    hashBytes( h, &nf, sizeof(int));
+    for ( int vid = 0; vid < nv; ++vid)
+        hashBytes( h, &model.uvtx(vid)[0], 3*sizeof(float));
+
+    for ( int fid = 0; fid < nf; ++fid)
+    {
+        hashBytes( h, model.fvidxs(fid), 3*sizeof(int));
+        const int* uvids = model.faceUVs(fid);
+        if ( uvids)
+        {
+            const int mid = model.faceMaterialId(fid);
+            hashBytes( h, &mid, sizeof(int));
+            for ( int i = 0; i < 3; ++i)
+                hashBytes( h, &model.uv( mid, uvids[i])[0], 2*sizeof(float));
+        }   // end if
+    }   // end for
+
+    // Textures are hashed by content (not buffer address which may be reused by a different image).
+    for ( int mid : model.materialIds())
+    {
+        const cv::Mat& tx = model.texture(mid);
+        const int hdr[3] = { tx.rows, tx.cols, tx.type()};
+        hashBytes( h, hdr, sizeof(hdr));
+        const size_t rowBytes = size_t(tx.cols) * tx.elemSize();
+        for ( int r = 0; r < tx.rows; ++r)
+            hashBytes( h, tx.ptr(r), rowBytes);
+    }   // end for
+
+    const cv::Matx44d& T = model.transformMatrix();
+    hashBytes( h, T.val, sizeof(T.val));
+    return h;
+}   // end hash
+
+
+size_t ActorCache::actorBytes( vtkActor* actor)
+{
+    size_t kib = 0;
+    vtkPolyData* pd = RVTK::getPolyData( actor);
+    if ( pd)
+        kib += pd->GetActualMemorySize();
+    vtkTexture* tx = actor->GetTexture();
+    if ( tx && tx->GetInput())
+        kib += tx->GetInput()->GetActualMemorySize();
+    return kib * 1024;
+}   // end actorBytes
+
+
+vtkSmartPointer<vtkActor> ActorCache::get( size_t key)
+{
+    auto it = _lookup.find( key);
+    if ( it == _lookup.end())
+    {
+        _misses++;
+        return nullptr;
+    }   // end if
+    _hits++;
+    _entries.splice( _entries.begin(), _entries, it->second);
+    return it->second->actor;
+}   // end get
+
+
+void ActorCache::put( size_t key, vtkSmartPointer<vtkActor> actor)
+{
+    auto it = _lookup.find( key);
+    if ( it != _lookup.end())
+    {
+        _bytes -= it->second->bytes;
+        _entries.erase( it->second);
+        _lookup.erase( it);
+    }   // end if
+
+    Entry e;
+    e.key = key;
+    e.actor = actor;
+    e.bytes = actorBytes( actor);
+    _entries.push_front( e);
+    _lookup[key] = _entries.begin();
+    _bytes += e.bytes;
+    evict();
+}   // end put
+
+
+void ActorCache::clear()
+{
+    _entries.clear();
+    _lookup.clear();
+    _bytes = 0;
+}   // end clear
+
+
+void ActorCache::setBudget( size_t budget)
+{
+    _budget = budget;
+    evict();
+}   // end setBudget
+
+
+// private
+void ActorCache::evict()
+{
+    while ( _bytes > _budget && _entries.size() > 1)
+    {
+        const Entry& e = _entries.back();
+        _bytes -= e.bytes;
+        _lookup.erase( e.key);
+        _entries.pop_back();
+        _evictions++;
+    }   // end while
+}   // end evict
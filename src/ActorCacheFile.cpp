@@ -0,0 +1,534 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <ActorCacheFile.h>
+#include <MappedFile.h>
+#include <VtkTools.h>
+#include <vtkCallbackCommand.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkImageData.h>
+#include <vtkProperty.h>
+#include <vtkTexture.h>
+#include <vtkPoints.h>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+
+namespace {
+
+const char MAGIC[8] = {'R','V','T','K','A','C','T','\0'};
+const uint32_t VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint64_t ALIGNMENT = 64;
+const uint32_t MAX_COMPONENTS = 1024;
+const size_t NAME_LEN = 64;
+
+enum CellType { VERTS, LINES, POLYS, STRIPS, NUM_CELL_TYPES};
+
+// What a stored array belongs to.
+enum Association { POINT_COORDS, POINT_DATA, CELL_DATA};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t idSize;        // sizeof(vtkIdType)
+    uint32_t texComps;      // Texture components (0 if no texture)
+    uint64_t sourceKey;
+    uint64_t npoints;
+    uint64_t narrays;       // Entries in the array table following the header (including the points)
+    uint64_t ncells[NUM_CELL_TYPES];
+    uint64_t ncellValues[NUM_CELL_TYPES];   // Length of each legacy cell array
+    uint64_t cellOffsets[NUM_CELL_TYPES];   // From the start of the file
+    uint64_t texWidth;
+    uint64_t texHeight;
+    uint64_t texOffset;
+    double matrix[16];
+    double ambient, diffuse, specular, opacity;
+};  // end struct
+
+struct ArrayEntry
+{
+    char name[NAME_LEN];    // Null terminated (empty if unnamed)
+    uint32_t assoc;         // Association
+    int32_t attribute;      // vtkDataSetAttributes::AttributeTypes or -1 if not an active attribute
+    int32_t dataType;       // VTK_FLOAT etc.
+    uint32_t ncomps;
+    uint64_t offset;        // From the start of the file (tuples from assoc)
+};  // end struct
+
+
+uint64_t alignUp( uint64_t v) { return (v + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;}
+
+
+// Set out to a*b returning false if it would overflow.
+bool mulSize( uint64_t a, uint64_t b, uint64_t& out)
+{
+    if ( a != 0 && b > UINT64_MAX / a)
+        return false;
+    out = a*b;
+    return true;
+}   // end mulSize
+
+
+// Returns true iff the nbytes at offset lie within a file of the given size (without overflowing).
+bool inFile( uint64_t offset, uint64_t nbytes, uint64_t fsize)
+{
+    return offset % ALIGNMENT == 0 && nbytes <= fsize && offset <= fsize - nbytes;
+}   // end inFile
+
+
+bool isStorableType( int t)
+{
+    switch ( t)
+    {
+        case VTK_CHAR: case VTK_SIGNED_CHAR: case VTK_UNSIGNED_CHAR:
+        case VTK_SHORT: case VTK_UNSIGNED_SHORT: case VTK_INT: case VTK_UNSIGNED_INT:
+        case VTK_LONG_LONG: case VTK_UNSIGNED_LONG_LONG: case VTK_ID_TYPE:
+        case VTK_FLOAT: case VTK_DOUBLE:
+            return true;
+        default:
+            return false;
+    }   // end switch
+}   // end isStorableType
+
+
+// Wrap the nvals values at offset as a new data array of the given type without copying. The array
+// holds a reference to the mapping which is released when the array (and so its observer) is deleted.
+vtkSmartPointer<vtkDataArray> wrapArray( const std::shared_ptr<RVTK::MappedFile>& mf, uint64_t offset,
+                                         int dataType, uint64_t nvals, int ncomps)
+{
+    vtkSmartPointer<vtkDataArray> arr;
+    arr.TakeReference( vtkDataArray::CreateDataArray( dataType));
+    arr->SetNumberOfComponents( ncomps);
+    arr->SetVoidArray( mf->writableData() + offset, vtkIdType(nvals), 1/*don't free*/);
+
+    vtkSmartPointer<vtkCallbackCommand> holder = vtkSmartPointer<vtkCallbackCommand>::New();
+    holder->SetClientData( new std::shared_ptr<RVTK::MappedFile>( mf));
+    holder->SetClientDataDeleteCallback( []( void* cd){ delete static_cast<std::shared_ptr<RVTK::MappedFile>*>(cd);});
+    arr->AddObserver( vtkCommand::DeleteEvent, holder);
+    return arr;
+}   // end wrapArray
+
+
+// Write nbytes at the next aligned position returning the offset written at.
+uint64_t writeRegion( std::ofstream& ofs, const void* data, uint64_t nbytes)
+{
+    const uint64_t pos = uint64_t( ofs.tellp());
+    const uint64_t apos = alignUp( pos);
+    static const char ZEROS[ALIGNMENT] = {0};
+    ofs.write( ZEROS, std::streamsize( apos - pos));
+    if ( nbytes > 0)
+        ofs.write( static_cast<const char*>(data), std::streamsize(nbytes));
+    return apos;
+}   // end writeRegion
+
+
+vtkCellArray* cellArray( vtkPolyData* pd, int ct)
+{
+    switch ( ct)
+    {
+        case VERTS: return pd->GetVerts();
+        case LINES: return pd->GetLines();
+        case POLYS: return pd->GetPolys();
+        default: return pd->GetStrips();
+    }   // end switch
+}   // end cellArray
+
+
+void setCellArray( vtkPolyData* pd, int ct, vtkCellArray* ca)
+{
+    switch ( ct)
+    {
+        case VERTS: pd->SetVerts( ca); break;
+        case LINES: pd->SetLines( ca); break;
+        case POLYS: pd->SetPolys( ca); break;
+        default: pd->SetStrips( ca); break;
+    }   // end switch
+}   // end setCellArray
+
+
+// An array to be written with its table entry.
+struct OutArray
+{
+    ArrayEntry entry;
+    vtkDataArray* array;
+};  // end struct
+
+
+// Add the array to the output list returning false (with a message) if it can't be stored.
+bool addArray( std::vector<OutArray>& outs, vtkAbstractArray* aa, Association assoc, int attribute)
+{
+    vtkDataArray* arr = vtkDataArray::SafeDownCast( aa);
+    const char* name = aa ? aa->GetName() : nullptr;
+    if ( !arr || !arr->HasStandardMemoryLayout() || !isStorableType( arr->GetDataType())
+            || uint32_t( arr->GetNumberOfComponents()) > MAX_COMPONENTS || (name && strlen(name) >= NAME_LEN))
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Unable to store array "
+                  << (name ? name : "(unnamed)") << "; not caching actor!" << std::endl;
+        return false;
+    }   // end if
+
+    OutArray out;
+    memset( &out.entry, 0, sizeof(ArrayEntry));
+    if ( name)
+        strcpy( out.entry.name, name);
+    out.entry.assoc = uint32_t(assoc);
+    out.entry.attribute = attribute;
+    out.entry.dataType = arr->GetDataType();
+    out.entry.ncomps = uint32_t( arr->GetNumberOfComponents());
+    out.array = arr;
+    outs.push_back( out);
+    return true;
+}   // end addArray
+
+
+bool addArrays( std::vector<OutArray>& outs, vtkDataSetAttributes* dsa, Association assoc)
+{
+    for ( int i = 0; i < dsa->GetNumberOfArrays(); ++i)
+        if ( !addArray( outs, dsa->GetAbstractArray(i), assoc, dsa->IsArrayAnAttribute(i)))
+            return false;
+    return true;
+}   // end addArrays
+
+
+// Atomically replace file to with file from. POSIX rename already replaces an existing file
+// atomically; on Windows, MoveFileEx is needed to replace (rename fails if to exists) so that
+// there's never a moment with no file (as there would be if removing the old one first).
+bool replaceFile( const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    return MoveFileExA( from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename( from.c_str(), to.c_str()) == 0;
+#endif
+}   // end replaceFile
+
+}   // end namespace
+
+
+uint64_t RVTK::hashFile( const std::string& fname)
+{
+    MappedFile mf( fname);
+    if ( !mf.isOpen())
+        return 0;
+    const char* p = mf.data();
+    const size_t n = mf.size();
+    const uint64_t PRIME = 1099511628211ULL;
+    uint64_t h = 14695981039346656037ULL ^ uint64_t(n);
+    // FNV-1a style mixing over 64 bit words then the trailing bytes.
+    const size_t nw = n / 8;
+    for ( size_t i = 0; i < nw; ++i)
+    {
+        uint64_t w;
+        memcpy( &w, p + 8*i, 8);
+        h = (h ^ w) * PRIME;
+        h ^= h >> 29;
+    }   // end for
+    for ( size_t i = 8*nw; i < n; ++i)
+        h = (h ^ uint64_t( static_cast<unsigned char>(p[i]))) * PRIME;
+    return h;
+}   // end hashFile
+
+
+bool RVTK::writeActorCacheFile( const std::string& fname, vtkActor* actor, uint64_t key)
+{
+    vtkPolyData* pd = actor ? getPolyData( actor) : nullptr;
+    if ( !pd || !pd->GetPoints())
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Actor has no polydata!" << std::endl;
+        return false;
+    }   // end if
+
+    // The points, all point data arrays and all cell data arrays are stored as they are.
+    std::vector<OutArray> outs;
+    if ( !addArray( outs, pd->GetPoints()->GetData(), POINT_COORDS, -1)
+            || !addArrays( outs, pd->GetPointData(), POINT_DATA)
+            || !addArrays( outs, pd->GetCellData(), CELL_DATA))
+        return false;
+
+    const vtkIdType npts = pd->GetNumberOfPoints();
+    const vtkIdType ncells = pd->GetNumberOfCells();
+    for ( const OutArray& out : outs)
+    {
+        if ( out.array->GetNumberOfTuples() != (out.entry.assoc == CELL_DATA ? ncells : npts))
+        {
+            std::cerr << "[ERROR] RVTK::writeActorCacheFile: Array tuples don't match points/cells; not caching actor!" << std::endl;
+            return false;
+        }   // end if
+    }   // end for
+
+    vtkImageData* img = nullptr;
+    if ( vtkTexture* tx = actor->GetTexture())
+    {
+        if ( tx->GetInputAlgorithm())
+            tx->GetInputAlgorithm()->Update();
+        img = tx->GetInput();
+    }   // end if
+    vtkUnsignedCharArray* texels = img ? vtkUnsignedCharArray::SafeDownCast( img->GetPointData()->GetScalars()) : nullptr;
+    if ( img && (!texels || texels->GetNumberOfComponents() < 1 || texels->GetNumberOfComponents() > 4))
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Texture is not 1 to 4 byte components; not caching actor!" << std::endl;
+        return false;
+    }   // end if
+
+    Header hdr;
+    memset( &hdr, 0, sizeof(Header));
+    memcpy( hdr.magic, MAGIC, sizeof(MAGIC));
+    hdr.version = VERSION;
+    hdr.byteOrder = BYTE_ORDER_MARK;
+    hdr.idSize = sizeof(vtkIdType);
+    hdr.sourceKey = key;
+    hdr.npoints = uint64_t( npts);
+    hdr.narrays = outs.size();
+    for ( int ct = 0; ct < NUM_CELL_TYPES; ++ct)
+    {
+        vtkCellArray* ca = cellArray( pd, ct);
+        hdr.ncells[ct] = ca ? uint64_t( ca->GetNumberOfCells()) : 0;
+        hdr.ncellValues[ct] = ca ? uint64_t( ca->GetData()->GetNumberOfValues()) : 0;
+    }   // end for
+    if ( texels)
+    {
+        const int* dims = img->GetDimensions();
+        hdr.texWidth = uint64_t( dims[0]);
+        hdr.texHeight = uint64_t( dims[1]);
+        hdr.texComps = uint32_t( texels->GetNumberOfComponents());
+    }   // end if
+
+    vtkMatrix4x4* m = actor->GetMatrix();
+    for ( int i = 0; i < 16; ++i)
+        hdr.matrix[i] = m->GetElement( i/4, i%4);
+    vtkProperty* prop = actor->GetProperty();
+    hdr.ambient = prop->GetAmbient();
+    hdr.diffuse = prop->GetDiffuse();
+    hdr.specular = prop->GetSpecular();
+    hdr.opacity = prop->GetOpacity();
+
+    const std::string tmpname = fname + ".tmp";
+    std::ofstream ofs( tmpname.c_str(), std::ios::binary);
+    if ( !ofs)
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Unable to open " << tmpname << std::endl;
+        return false;
+    }   // end if
+
+    // Header and array table are rewritten with the offsets once the regions are written.
+    ofs.write( reinterpret_cast<const char*>(&hdr), sizeof(Header));
+    for ( const OutArray& out : outs)
+        ofs.write( reinterpret_cast<const char*>(&out.entry), sizeof(ArrayEntry));
+
+    for ( OutArray& out : outs)
+    {
+        vtkDataArray* arr = out.array;
+        const uint64_t nbytes = uint64_t( arr->GetNumberOfValues()) * uint64_t( arr->GetDataTypeSize());
+        out.entry.offset = writeRegion( ofs, nbytes > 0 ? arr->GetVoidPointer(0) : nullptr, nbytes);
+    }   // end for
+    for ( int ct = 0; ct < NUM_CELL_TYPES; ++ct)
+    {
+        vtkCellArray* ca = cellArray( pd, ct);
+        const uint64_t nbytes = hdr.ncellValues[ct] * sizeof(vtkIdType);
+        hdr.cellOffsets[ct] = writeRegion( ofs, nbytes > 0 ? ca->GetData()->GetPointer(0) : nullptr, nbytes);
+    }   // end for
+    hdr.texOffset = writeRegion( ofs, texels ? texels->GetPointer(0) : nullptr, hdr.texWidth*hdr.texHeight*hdr.texComps);
+
+    ofs.seekp(0);
+    ofs.write( reinterpret_cast<const char*>(&hdr), sizeof(Header));
+    for ( const OutArray& out : outs)
+        ofs.write( reinterpret_cast<const char*>(&out.entry), sizeof(ArrayEntry));
+    ofs.close();
+    if ( !ofs)
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Failed writing " << tmpname << std::endl;
+        std::remove( tmpname.c_str());
+        return false;
+    }   // end if
+
+    if ( !replaceFile( tmpname, fname))
+    {
+        std::cerr << "[ERROR] RVTK::writeActorCacheFile: Unable to rename " << tmpname << std::endl;
+        std::remove( tmpname.c_str());
+        return false;
+    }   // end if
+    return true;
+}   // end writeActorCacheFile
+
+
+namespace {
+
+// Check that every region described by the header and array table lies within the file with its size
+// given exactly by its counts. Cell contents (point IDs) are not checked since that would mean reading
+// every page; a file matching the source key is trusted to have been written by writeActorCacheFile.
+bool validate( const Header& hdr, const ArrayEntry* entries, uint64_t fsize)
+{
+    if ( hdr.npoints > uint64_t(VTK_ID_MAX))
+        return false;
+
+    uint64_t totalCells = 0;
+    for ( int ct = 0; ct < NUM_CELL_TYPES; ++ct)
+    {
+        uint64_t nbytes;
+        if ( hdr.ncells[ct] > hdr.ncellValues[ct] || !mulSize( hdr.ncellValues[ct], sizeof(vtkIdType), nbytes)
+                || !inFile( hdr.cellOffsets[ct], nbytes, fsize))
+            return false;
+        totalCells += hdr.ncells[ct];   // Can't overflow since each is bounded by the file size
+    }   // end for
+
+    size_t npointArrays = 0;
+    for ( uint64_t i = 0; i < hdr.narrays; ++i)
+    {
+        const ArrayEntry& e = entries[i];
+        uint64_t ntuples = hdr.npoints;
+        if ( e.assoc == POINT_COORDS)
+        {
+            npointArrays++;
+            if ( e.ncomps != 3 || (e.dataType != VTK_FLOAT && e.dataType != VTK_DOUBLE))
+                return false;
+        }   // end if
+        else if ( e.assoc == CELL_DATA)
+            ntuples = totalCells;
+        else if ( e.assoc != POINT_DATA)
+            return false;
+
+        uint64_t nvals, nbytes;
+        if ( memchr( e.name, 0, NAME_LEN) == nullptr || !isStorableType( e.dataType)
+                || e.ncomps < 1 || e.ncomps > MAX_COMPONENTS || e.attribute >= vtkDataSetAttributes::NUM_ATTRIBUTES
+                || !mulSize( ntuples, e.ncomps, nvals) || !mulSize( nvals, uint64_t( vtkDataArray::GetDataTypeSize( e.dataType)), nbytes)
+                || !inFile( e.offset, nbytes, fsize))
+            return false;
+    }   // end for
+    if ( npointArrays != 1)
+        return false;
+
+    uint64_t texBytes = 0;
+    if ( hdr.texComps > 4 || hdr.texWidth > uint64_t(INT_MAX) || hdr.texHeight > uint64_t(INT_MAX)
+            || !mulSize( hdr.texWidth, hdr.texHeight, texBytes) || !mulSize( texBytes, hdr.texComps, texBytes)
+            || !inFile( hdr.texOffset, texBytes, fsize))
+        return false;
+    return hdr.texComps == 0 || texBytes > 0;
+}   // end validate
+
+}   // end namespace
+
+
+vtkSmartPointer<vtkActor> RVTK::readActorCacheFile( const std::string& fname, uint64_t key)
+{
+    // Only the header is read through before the arrays are wrapped and then read (in whatever
+    // order VTK needs them) so don't have the OS read ahead of each page touched.
+    std::shared_ptr<MappedFile> mf = std::make_shared<MappedFile>( fname, true/*copy on write*/, MappedFile::RANDOM);
+    if ( !mf->isOpen() || mf->size() < sizeof(Header))
+        return nullptr;
+
+    Header hdr;
+    memcpy( &hdr, mf->data(), sizeof(Header));
+    if ( memcmp( hdr.magic, MAGIC, sizeof(MAGIC)) != 0 || hdr.version != VERSION
+            || hdr.byteOrder != BYTE_ORDER_MARK || hdr.idSize != sizeof(vtkIdType) || hdr.sourceKey != key)
+        return nullptr;
+
+    const uint64_t fsize = mf->size();
+    std::vector<ArrayEntry> entries;
+    if ( hdr.narrays <= (fsize - sizeof(Header)) / sizeof(ArrayEntry))
+    {
+        entries.resize( size_t( hdr.narrays));
+        memcpy( entries.data(), mf->data() + sizeof(Header), entries.size() * sizeof(ArrayEntry));
+    }   // end if
+
+    if ( entries.size() != hdr.narrays || !validate( hdr, entries.data(), fsize))
+    {
+        std::cerr << "[ERROR] RVTK::readActorCacheFile: Corrupt cache file " << fname << std::endl;
+        return nullptr;
+    }   // end if
+
+    uint64_t totalCells = 0;
+    for ( int ct = 0; ct < NUM_CELL_TYPES; ++ct)
+        totalCells += hdr.ncells[ct];
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    for ( const ArrayEntry& e : entries)
+    {
+        const uint64_t ntuples = e.assoc == CELL_DATA ? totalCells : hdr.npoints;
+        vtkSmartPointer<vtkDataArray> arr = wrapArray( mf, e.offset, e.dataType, ntuples * e.ncomps, int(e.ncomps));
+        if ( e.name[0])
+            arr->SetName( e.name);
+
+        if ( e.assoc == POINT_COORDS)
+        {
+            vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+            points->SetData( arr);
+            pd->SetPoints( points);
+            continue;
+        }   // end if
+
+        vtkDataSetAttributes* dsa = e.assoc == CELL_DATA ? (vtkDataSetAttributes*)pd->GetCellData() : (vtkDataSetAttributes*)pd->GetPointData();
+        const int idx = dsa->AddArray( arr);
+        if ( e.attribute >= 0)
+            dsa->SetActiveAttribute( idx, e.attribute);
+    }   // end for
+
+    for ( int ct = 0; ct < NUM_CELL_TYPES; ++ct)
+    {
+        if ( hdr.ncellValues[ct] == 0)
+            continue;
+        vtkSmartPointer<vtkCellArray> ca = vtkSmartPointer<vtkCellArray>::New();
+        ca->SetCells( vtkIdType( hdr.ncells[ct]), vtkIdTypeArray::SafeDownCast(
+                    wrapArray( mf, hdr.cellOffsets[ct], VTK_ID_TYPE, hdr.ncellValues[ct], 1)));
+        setCellArray( pd, ct, ca);
+    }   // end for
+
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData( pd);
+    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper( mapper);
+
+    if ( hdr.texComps > 0)
+    {
+        vtkSmartPointer<vtkImageData> img = vtkSmartPointer<vtkImageData>::New();
+        img->SetDimensions( int(hdr.texWidth), int(hdr.texHeight), 1);
+        img->GetPointData()->SetScalars( wrapArray( mf, hdr.texOffset, VTK_UNSIGNED_CHAR,
+                                         hdr.texWidth*hdr.texHeight*hdr.texComps, int(hdr.texComps)));
+        vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+        texture->SetInputData( img);
+        actor->SetTexture( texture);
+    }   // end if
+
+    // The stored matrix is the actor's full transform so it's restored as the user matrix
+    // (with position, orientation and scale left at their defaults).
+    vtkSmartPointer<vtkMatrix4x4> m = vtkSmartPointer<vtkMatrix4x4>::New();
+    for ( int i = 0; i < 16; ++i)
+        m->SetElement( i/4, i%4, hdr.matrix[i]);
+    actor->SetUserMatrix( m);
+    vtkProperty* prop = actor->GetProperty();
+    prop->SetAmbient( hdr.ambient);
+    prop->SetDiffuse( hdr.diffuse);
+    prop->SetSpecular( hdr.specular);
+    prop->SetOpacity( hdr.opacity);
+    return actor;
+}   // end readActorCacheFile
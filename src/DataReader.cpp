@@ -16,10 +16,13 @@
  ************************************************************************/
 
 #include "DataReader.h"
+#include "MeshFileReader.h"
 using namespace RVTK;
 
 #include <vtkBYUReader.h>
 #include <vtkPolyDataReader.h>
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 using std::ostringstream;
 
@@ -39,8 +42,19 @@ const char* DataReaderException::what() const throw()
 DataReader::DataReader( const string &fname) throw(DataReaderException)
 {
    string ext = fname.substr(fname.rfind('.'));
+   string lext = ext;
+   std::transform( lext.begin(), lext.end(), lext.begin(), ::tolower);
 
-   if (ext.compare( ".g") == 0)
+   // PLY, STL and OBJ are read lazily (on pipeline update) through the memory mapped
+   // readers with progress and cancellation, falling back to the VTK readers for the
+   // forms they don't handle (e.g. ASCII PLY/STL).
+   if ( lext.compare( ".ply") == 0 || lext.compare( ".stl") == 0 || lext.compare( ".obj") == 0)
+   {
+      MeshFileReader* r = MeshFileReader::New();
+      r->SetFileName( fname.c_str());
+      m_reader = r;
+   }  // end if
+   else if (ext.compare( ".g") == 0)
    {
       vtkBYUReader* r = vtkBYUReader::New();
       r->SetFileName( fname.c_str());
@@ -0,0 +1,183 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <FrameCapture.h>
+#include <Viewer.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtk_glew.h>
+#include <algorithm>
+using RVTK::FrameCapture;
+
+
+FrameCapture::FrameCapture( vtkRenderWindow* rw)
+    : _renWin(rw), _viewer(nullptr), _rgb( vtkSmartPointer<vtkUnsignedCharArray>::New()),
+      _z( vtkSmartPointer<vtkFloatArray>::New()), _front(true), _next(0)
+{
+    for ( int i = 0; i < 2; ++i)
+    {
+        _pbo[i] = 0;
+        _pboBytes[i] = 0;
+        _pending[i] = false;
+    }   // end for
+}   // end ctor
+
+
+FrameCapture::FrameCapture( Viewer& v) : FrameCapture( v.renderWindow())
+{
+    _viewer = &v;
+}   // end ctor
+
+
+FrameCapture::~FrameCapture()
+{
+    if ( (_pbo[0] || _pbo[1]) && _renWin)
+    {
+        _renWin->MakeCurrent();
+        for ( int i = 0; i < 2; ++i)
+            if ( _pbo[i])
+                glDeleteBuffers( 1, &_pbo[i]);
+    }   // end if
+}   // end dtor
+
+
+namespace {
+
+// Adds the time from construction to destruction to the viewer's readback time if its stats are enabled.
+class ReadbackTimer
+{
+public:
+    explicit ReadbackTimer( RVTK::Viewer* v) : _stats( v ? v->stats() : nullptr), _t0( _stats ? _stats->now() : 0) {}
+    ~ReadbackTimer() { if ( _stats) _stats->addReadback( _stats->now() - _t0);}
+private:
+    RVTK::RenderStats* _stats;
+    const double _t0;
+};  // end class
+
+
+// Write bottom up RGB rows (as read back from VTK/OpenGL) into img as top down BGR rows
+// using OpenCV's vectorised flip and in place channel swap (img is not reallocated).
+void toTopDownBGR( const cv::Mat& rgb, cv::Mat_<cv::Vec3b>& img)
+{
+    cv::flip( rgb, img, 0);
+    cv::cvtColor( img, img, cv::COLOR_RGB2BGR);
+}   // end toTopDownBGR
+
+}   // end namespace
+
+
+// private
+cv::Size FrameCapture::regionSize() const
+{
+    const int* wsz = _renWin->GetSize();
+    if ( _rsz.area() <= 0)
+        return cv::Size( wsz[0], wsz[1]);
+    return cv::Size( std::min( _rsz.width, wsz[0]), std::min( _rsz.height, wsz[1]));
+}   // end regionSize
+
+
+void FrameCapture::readColour( cv::Mat_<cv::Vec3b>& img)
+{
+    const cv::Size rsz = regionSize();
+    const int cols = rsz.width;
+    const int rows = rsz.height;
+    img.create( rows, cols);
+    if ( rows <= 0 || cols <= 0)
+        return;
+
+    const ReadbackTimer timer( _viewer);
+
+    _renWin->GetPixelData( 0, 0, cols-1, rows-1, _front ? 1 : 0, _rgb);
+    toTopDownBGR( cv::Mat( rows, cols, CV_8UC3, _rgb->GetPointer(0)), img);
+}   // end readColour
+
+
+bool FrameCapture::beginColourRead()
+{
+    vtkOpenGLRenderWindow* glw = vtkOpenGLRenderWindow::SafeDownCast( _renWin);
+    const cv::Size rsz = regionSize();
+    const int cols = rsz.width;
+    const int rows = rsz.height;
+    if ( !glw || rows <= 0 || cols <= 0)
+        return false;
+
+    const ReadbackTimer timer( _viewer);
+    glw->MakeCurrent();
+
+    // Use the buffer not most recently written to (dropping its read if never collected).
+    const int i = _next;
+    const size_t nbytes = size_t(rows) * size_t(cols) * 3;
+    if ( !_pbo[i])
+        glGenBuffers( 1, &_pbo[i]);
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, _pbo[i]);
+    if ( _pboBytes[i] != nbytes)
+    {
+        glBufferData( GL_PIXEL_PACK_BUFFER, GLsizeiptr(nbytes), nullptr, GL_STREAM_READ);
+        _pboBytes[i] = nbytes;
+    }   // end if
+
+    // With a pack buffer bound, glReadPixels queues the copy and returns without waiting for it.
+    GLint align = 4;
+    glGetIntegerv( GL_PACK_ALIGNMENT, &align);
+    glPixelStorei( GL_PACK_ALIGNMENT, 1);
+    glReadBuffer( _front ? glw->GetFrontLeftBuffer() : glw->GetBackLeftBuffer());
+    glReadPixels( 0, 0, cols, rows, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei( GL_PACK_ALIGNMENT, align);
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0);
+
+    _pboSize[i] = cv::Size( cols, rows);
+    _pending[i] = true;
+    _next = 1 - i;
+    return true;
+}   // end beginColourRead
+
+
+bool FrameCapture::endColourRead( cv::Mat_<cv::Vec3b>& img)
+{
+    const int i = _pending[_next] ? _next : 1 - _next;  // The oldest read not yet collected
+    if ( !_pending[i])
+        return false;
+    _pending[i] = false;
+
+    const ReadbackTimer timer( _viewer);
+    _renWin->MakeCurrent();
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, _pbo[i]);
+    const void* data = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(_pboBytes[i]), GL_MAP_READ_BIT);
+    if ( data)
+    {
+        img.create( _pboSize[i]);
+        toTopDownBGR( cv::Mat( _pboSize[i], CV_8UC3, const_cast<void*>(data)), img);
+        glUnmapBuffer( GL_PIXEL_PACK_BUFFER);
+    }   // end if
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0);
+    return data != nullptr;
+}   // end endColourRead
+
+
+void FrameCapture::readDepth( cv::Mat_<float>& img)
+{
+    const cv::Size rsz = regionSize();
+    const int cols = rsz.width;
+    const int rows = rsz.height;
+    img.create( rows, cols);
+    if ( rows <= 0 || cols <= 0)
+        return;
+
+    const ReadbackTimer timer( _viewer);
+
+    _renWin->GetZbufferData( 0, 0, cols-1, rows-1, _z);
+    cv::flip( cv::Mat( rows, cols, CV_32FC1, _z->GetPointer(0)), img, 0);
+}   // end readDepth
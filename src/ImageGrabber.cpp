@@ -17,43 +17,405 @@
 
 #include <ImageGrabber.h>
 #include <VtkTools.h>
-#include <FeatureUtils.h>   // RFeatures
+#include <vtkRendererCollection.h>
+#include <vtkHardwareSelector.h>
+#include <vtkNew.h>
+#include <vtkRenderer.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtk_glew.h>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <iostream>
 using RVTK::ImageGrabber;
 using RVTK::Viewer;
 
+
+namespace {
+
+// Barycentric coordinates of p in the given triangle (zero if the triangle is degenerate).
+cv::Vec3f barycentrics( const cv::Vec3f& p, const cv::Vec3f& a, const cv::Vec3f& b, const cv::Vec3f& c)
+{
+    const cv::Vec3f v0 = b - a;
+    const cv::Vec3f v1 = c - a;
+    const cv::Vec3f v2 = p - a;
+    const float d00 = v0.dot(v0);
+    const float d01 = v0.dot(v1);
+    const float d11 = v1.dot(v1);
+    const float d20 = v2.dot(v0);
+    const float d21 = v2.dot(v1);
+    const float den = d00 * d11 - d01 * d01;
+    if ( den == 0.0f)
+        return cv::Vec3f(0,0,0);
+    const float v = (d11 * d20 - d01 * d21) / den;
+    const float w = (d00 * d21 - d01 * d20) / den;
+    return cv::Vec3f( 1.0f - v - w, v, w);
+}   // end barycentrics
+
+
+// Get the world positions (using actor transform T) of the vertices of the given triangle on the actor.
+bool cellTriangle( vtkActor* actor, const cv::Matx44d& T, int cid, cv::Vec3f* tri)
+{
+    vtkPolyData* pd = RVTK::getPolyData( actor);
+    if ( !pd || cid < 0 || cid >= pd->GetNumberOfCells())
+        return false;
+    vtkIdType npts;
+    vtkIdType* pids;
+    pd->GetCellPoints( cid, npts, pids);
+    if ( npts != 3)
+        return false;
+
+    double p[3];
+    for ( int i = 0; i < 3; ++i)
+    {
+        pd->GetPoint( pids[i], p);
+        const cv::Vec4d v = T * cv::Vec4d( p[0], p[1], p[2], 1);
+        tri[i] = cv::Vec3f( float(v[0]), float(v[1]), float(v[2]));
+    }   // end for
+    return true;
+}   // end cellTriangle
+
+
+// Decode the 24 bit value stored (red lowest) in the RGB pixel at byte offset k of a hardware selector pass buffer.
+inline int decodeID( const unsigned char* pb, size_t k)
+{
+    return int(pb[k]) | (int(pb[k+1]) << 8) | (int(pb[k+2]) << 16);
+}   // end decodeID
+
+
+// Scales the viewports of a render window's renderers so they render into the bottom left
+// part of the window, restoring the viewports (and buffer swapping) on destruction.
+class ViewportScaler
+{
+public:
+    ViewportScaler( vtkRenderWindow* rw, double sx, double sy) : _renWin(rw), _swap( rw->GetSwapBuffers())
+    {
+        vtkRendererCollection* rens = rw->GetRenderers();
+        rens->InitTraversal();
+        while ( vtkRenderer* ren = rens->GetNextItem())
+        {
+            const double* vp = ren->GetViewport();
+            _vps.push_back( std::make_pair( ren, cv::Vec4d( vp[0], vp[1], vp[2], vp[3])));
+            ren->SetViewport( vp[0]*sx, vp[1]*sy, vp[2]*sx, vp[3]*sy);
+        }   // end while
+        // Don't show the partial frame in an on screen window (it's read from the back buffer).
+        rw->SetSwapBuffers(0);
+    }   // end ctor
+
+    ~ViewportScaler()
+    {
+        for ( const auto& rvp : _vps)
+            rvp.first->SetViewport( rvp.second[0], rvp.second[1], rvp.second[2], rvp.second[3]);
+        _renWin->SetSwapBuffers( _swap);
+    }   // end dtor
+
+private:
+    vtkRenderWindow* _renWin;
+    const int _swap;
+    std::vector<std::pair<vtkRenderer*, cv::Vec4d> > _vps;
+};  // end class
+
+
+// The largest size that can be rendered into the given window without it being shown resized.
+// An offscreen window can be resized up to the maximum OpenGL viewport, but an on screen window
+// is limited to its current size.
+cv::Size maxRenderSize( vtkRenderWindow* rw)
+{
+    const int* wsz = rw->GetSize();
+    cv::Size msz( wsz[0], wsz[1]);
+    if ( rw->GetOffScreenRendering() && vtkOpenGLRenderWindow::SafeDownCast( rw))
+    {
+        GLint dims[2] = {0,0};
+        rw->MakeCurrent();
+        glGetIntegerv( GL_MAX_VIEWPORT_DIMS, dims);
+        msz.width = std::max( msz.width, int(dims[0]));
+        msz.height = std::max( msz.height, int(dims[1]));
+    }   // end if
+    return msz;
+}   // end maxRenderSize
+
+}   // end namespace
+
 // public
-ImageGrabber::ImageGrabber( vtkRenderWindow* rw, int h) : _renWin(rw)
+ImageGrabber::ImageGrabber( vtkRenderWindow* rw, int h, bool atTarget, int ss)
+    : _renWin(rw), _capture(rw), _atTarget(atTarget), _ssample( std::max( 1, ss)), _external(false), _nthreads(0), _direct(false),
+      _cam( vtkSmartPointer<vtkCamera>::New()), _aspect(1), _viewport(0,0,1,1), _unprojected(false)
 {
     refresh(h);
 }   // end ctor
 
 // public
-ImageGrabber::ImageGrabber( Viewer& v, int h) : _renWin(v.renderWindow())
+ImageGrabber::ImageGrabber( Viewer& v, int h, bool atTarget, int ss)
+    : _renWin(v.renderWindow()), _capture(v), _atTarget(atTarget), _ssample( std::max( 1, ss)), _external(false), _nthreads(0), _direct(false),
+      _cam( vtkSmartPointer<vtkCamera>::New()), _aspect(1), _viewport(0,0,1,1), _unprojected(false)
 {
     refresh(h);
 }   // end ctor
 
 
+// public
+void ImageGrabber::setRenderAtTarget( bool enable, int ss)
+{
+    _atTarget = enable;
+    _ssample = std::max( 1, ss);
+}   // end setRenderAtTarget
+
+
 // public
 void ImageGrabber::refresh( int reqHeight)
 {
-    if ( reqHeight <= 0)
-        reqHeight = _renWin->GetSize()[1];
-    // Get the raw input images at their view size
-    const cv::Mat_<cv::Vec3b> cimg = RVTK::extractImage( _renWin);
-    const cv::Mat_<float> dimg = RVTK::extractZBuffer( _renWin);
-
-    const cv::Size REQSZ( cvRound( reqHeight * double(cimg.cols)/cimg.rows), reqHeight);
-    cv::resize( dimg, _dzmap, REQSZ); // Resize depth image to required dims
-    cv::resize( cimg, _colmap, REQSZ); // Resize colour image to required dims
-    // Get the contrast stretched CIE-L component
-    _dcmap = RFeatures::contrastStretch( RFeatures::getLightness( _colmap, 255, CV_8U));
-
-    // Make a depth byte map from the reduced size z-buffer map
-    double mn, mx;
-    cv::minMaxLoc( _dzmap, &mn, &mx);
-    cv::Mat_<float> rngMap = _dzmap.clone();
-    rngMap -= float(mn);   // Make nearest point 0
-    const float depthProp = 1.0;    // Proportion of depth buffer to use (also try 1/2)
-    rngMap.convertTo( _ddmap, CV_8U, -255./((mx-mn)*depthProp), 255);
+    // Don't write over the caller's images from the last refresh into external buffers.
+    if ( _external)
+    {
+        _colmap.release();
+        _dcmap.release();
+        _dzmap.release();
+        _external = false;
+    }   // end if
+    grab( _colmap, _dcmap, _dzmap, reqHeight);
+}   // end refresh
+
+
+// public
+void ImageGrabber::refresh( cv::Mat_<cv::Vec3b>& colour, cv::Mat_<byte>& light, cv::Mat_<float>& depth, int reqHeight)
+{
+    grab( colour, light, depth, reqHeight);
+    // Share (not copy) the caller's images so the accessors and unprojection work as usual.
+    _colmap = colour;
+    _dcmap = light;
+    _dzmap = depth;
+    _external = true;
 }   // end refresh
+
+
+// private
+void ImageGrabber::grab( cv::Mat_<cv::Vec3b>& colmap, cv::Mat_<byte>& dcmap, cv::Mat_<float>& dzmap, int reqHeight)
+{
+    const int* wsz = _renWin->GetSize();
+    const cv::Size WINSZ( wsz[0], wsz[1]);
+    if ( reqHeight <= 0)
+        reqHeight = WINSZ.height;
+    const cv::Size REQSZ( cvRound( reqHeight * double(WINSZ.width)/WINSZ.height), reqHeight);
+
+    // When rendering at target, the supersample factor is clamped so the render fits within the window
+    // (or the maximum OpenGL viewport for an offscreen window). A target too big even without supersampling
+    // is rendered at window size and scaled up as usual.
+    cv::Size RENSZ = WINSZ;
+    if ( _atTarget && REQSZ.area() > 0)
+    {
+        const cv::Size MAXSZ = maxRenderSize( _renWin);
+        const int ss = std::min( _ssample, std::min( MAXSZ.width / REQSZ.width, MAXSZ.height / REQSZ.height));
+        if ( ss >= 1)
+            RENSZ = REQSZ * ss;
+    }   // end if
+
+    // A render that fits within the window is done by shrinking the renderers' viewports rather than
+    // resizing the window, so an on screen window is never resized (or shown the shrunken frame).
+    // Only an offscreen window is ever resized (to render bigger than it is).
+    const bool inWindow = RENSZ.width <= WINSZ.width && RENSZ.height <= WINSZ.height;
+    const bool resizeWin = !inWindow;
+    std::unique_ptr<ViewportScaler> vpscaler;
+    const bool front = _capture.readFrontBuffer();
+    if ( resizeWin)
+        _renWin->SetSize( RENSZ.width, RENSZ.height);
+    else if ( RENSZ != WINSZ)
+    {
+        vpscaler.reset( new ViewportScaler( _renWin, double(RENSZ.width) / WINSZ.width, double(RENSZ.height) / WINSZ.height));
+        _capture.setReadSize( RENSZ);
+        if ( !_renWin->GetOffScreenRendering())
+            _capture.setReadFrontBuffer( false);
+    }   // end else if
+
+    // Get the raw input images at the render size, reading straight into the output images
+    // if they're already at the required size (so there's nothing to resize or copy).
+    _renWin->Render();
+    _direct = RENSZ == REQSZ;
+    _capture.readColour( _direct ? colmap : _rawcol);
+    _capture.readDepth( _direct ? dzmap : _rawz);
+
+    vtkRenderer* ren = _renWin->GetRenderers()->GetFirstRenderer();
+    if ( ren)
+    {
+        _cam->DeepCopy( ren->GetActiveCamera());
+        _aspect = ren->GetTiledAspectRatio();
+    }   // end if
+    _unprojected = false;
+
+    if ( resizeWin)
+        _renWin->SetSize( WINSZ.width, WINSZ.height);
+    else if ( vpscaler)
+    {
+        vpscaler.reset();
+        _capture.setReadSize( cv::Size());
+        _capture.setReadFrontBuffer( front);
+    }   // end else if
+
+    // The renderer's own viewport within the images (the images are of the shrunken viewports if rendering
+    // at target so the unscaled viewport is also correct for them).
+    if ( ren)
+        _viewport = cv::Vec4d( ren->GetViewport());
+
+    if ( !_direct && _atTarget)
+    {
+        // Integer factor supersampling so INTER_AREA is an exact box filter.
+        cv::resize( _rawz, dzmap, REQSZ, 0, 0, cv::INTER_NEAREST);
+        cv::resize( _rawcol, colmap, REQSZ, 0, 0, cv::INTER_AREA);
+    }   // end if
+    else if ( !_direct)
+    {
+        cv::resize( _rawz, dzmap, REQSZ); // Resize depth image to required dims
+        cv::resize( _rawcol, colmap, REQSZ); // Resize colour image to required dims
+    }   // end else if
+    // Get the contrast stretched CIE-L component and a depth byte map from the reduced size
+    // z-buffer map in two (fused) sweeps over the images.
+    RVTK::makeLightnessAndDepthMaps( colmap, dzmap, dcmap, _ddmap, 1.0f, _nthreads);
+}   // end grab
+
+
+// public
+cv::Mat_<float> ImageGrabber::linearDepth() const
+{
+    unproject();
+    return _edmap;
+}   // end linearDepth
+
+
+// public
+cv::Mat_<cv::Vec3f> ImageGrabber::points() const
+{
+    unproject();
+    return _ptsmap;
+}   // end points
+
+
+// private
+void ImageGrabber::unproject() const
+{
+    if ( _unprojected)
+        return;
+    // The depth map may have been interpolated which would make ghost points between the foreground
+    // and background at silhouettes, so unproject the nearest raw z-buffer values instead.
+    if ( _direct)
+        RVTK::unprojectZBuffer( _cam, _aspect, _dzmap, &_edmap, &_ptsmap, _nthreads, _viewport);
+    else if ( _rawz.size() == _dzmap.size())
+        RVTK::unprojectZBuffer( _cam, _aspect, _rawz, &_edmap, &_ptsmap, _nthreads, _viewport);
+    else
+    {
+        cv::Mat_<float> zmap;
+        cv::resize( _rawz, zmap, _dzmap.size(), 0, 0, cv::INTER_NEAREST);
+        RVTK::unprojectZBuffer( _cam, _aspect, zmap, &_edmap, &_ptsmap, _nthreads, _viewport);
+    }   // end else
+    _unprojected = true;
+}   // end unproject
+
+
+// public
+bool ImageGrabber::cellIds( cv::Mat_<int>& cids, vtkActor* actor, cv::Mat_<cv::Vec3f>* bcoords) const
+{
+    vtkRenderer* ren = _renWin->GetRenderers()->GetFirstRenderer();
+    if ( !ren)
+        return false;
+
+    const int* wsz = _renWin->GetSize();
+    vtkNew<vtkHardwareSelector> selector;
+    selector->SetRenderer( ren);
+    selector->SetFieldAssociation( vtkDataObject::FIELD_ASSOCIATION_CELLS);
+    selector->SetArea( 0, 0, wsz[0]-1, wsz[1]-1);
+    if ( !selector->CaptureBuffers())
+    {
+        std::cerr << "[ERROR] RVTK::ImageGrabber::cellIds: Unable to capture ID buffers!" << std::endl;
+        return false;
+    }   // end if
+
+    // Decode the IDs straight from the captured pass buffers (bottom row first over the whole window)
+    // rather than calling GetPixelInformation per pixel. As for GetPixelInformation, the prop and
+    // attribute IDs are stored offset by one (zero being nothing) with the attribute ID split over
+    // the ID_LOW24, ID_MID24 and ID_HIGH16 passes (the latter two only rendered if needed).
+    const unsigned char* apass = selector->GetPixelBuffer( vtkHardwareSelector::ACTOR_PASS);
+    const unsigned char* lpass = selector->GetPixelBuffer( vtkHardwareSelector::ID_LOW24);
+    const unsigned char* mpass = selector->GetPixelBuffer( vtkHardwareSelector::ID_MID24);
+    const unsigned char* hpass = selector->GetPixelBuffer( vtkHardwareSelector::ID_HIGH16);
+    if ( !apass || !lpass)
+    {
+        std::cerr << "[ERROR] RVTK::ImageGrabber::cellIds: ID buffers missing!" << std::endl;
+        selector->ClearBuffers();
+        return false;
+    }   // end if
+
+    // Read the IDs top row first with the index of the showing actor at each pixel.
+    cv::Mat_<int> wids( wsz[1], wsz[0]);
+    cv::Mat_<int> waidx( wsz[1], wsz[0]);
+    std::vector<vtkActor*> actors;
+    std::unordered_map<int, int> actorIdx;  // Prop ID to index into actors (-1 if not a wanted actor)
+    for ( int i = 0; i < wsz[1]; ++i)
+    {
+        int* idrow = wids.ptr<int>(i);
+        int* arow = waidx.ptr<int>(i);
+        const size_t roff = size_t( wsz[1] - 1 - i) * size_t(wsz[0]);
+        for ( int j = 0; j < wsz[0]; ++j)
+        {
+            idrow[j] = arow[j] = -1;
+            const size_t k = 3 * (roff + size_t(j));
+            const int pid = decodeID( apass, k) - 1;
+            if ( pid < 0)
+                continue;
+
+            auto it = actorIdx.find( pid);
+            if ( it == actorIdx.end())
+            {
+                vtkActor* a = vtkActor::SafeDownCast( selector->GetPropFromID( pid));
+                int aidx = -1;
+                if ( a && (!actor || a == actor))
+                {
+                    aidx = int(actors.size());
+                    actors.push_back(a);
+                }   // end if
+                it = actorIdx.insert( std::make_pair( pid, aidx)).first;
+            }   // end if
+            if ( it->second < 0)
+                continue;
+
+            vtkIdType aid = hpass ? vtkIdType( decodeID( hpass, k)) : 0;
+            aid = (aid << 24) | (mpass ? vtkIdType( decodeID( mpass, k)) : 0);
+            aid = (aid << 24) | vtkIdType( decodeID( lpass, k));
+            if ( --aid < 0)
+                continue;
+            idrow[j] = static_cast<int>(aid);
+            arow[j] = it->second;
+        }   // end for
+    }   // end for
+    selector->ClearBuffers();
+
+    const cv::Size sz = size();
+    if ( sz == wids.size())
+        cids = wids;
+    else
+    {
+        cv::resize( wids, cids, sz, 0, 0, cv::INTER_NEAREST);
+        cv::resize( waidx, waidx, sz, 0, 0, cv::INTER_NEAREST);
+    }   // end else
+
+    if ( bcoords)
+    {
+        const cv::Mat_<cv::Vec3f> pts = points();
+        bcoords->create( sz);
+        std::vector<cv::Matx44d> tforms;
+        for ( vtkActor* a : actors)
+            tforms.push_back( RVTK::toCV( a->GetMatrix()));
+        cv::Vec3f tri[3];
+        for ( int i = 0; i < sz.height; ++i)
+        {
+            for ( int j = 0; j < sz.width; ++j)
+            {
+                cv::Vec3f& bc = (*bcoords)(i,j);
+                bc = cv::Vec3f(0,0,0);
+                const int cid = cids(i,j);
+                const size_t aidx = size_t(waidx(i,j));
+                if ( cid >= 0 && cellTriangle( actors[aidx], tforms[aidx], cid, tri))
+                    bc = barycentrics( pts(i,j), tri[0], tri[1], tri[2]);
+            }   // end for
+        }   // end for
+    }   // end if
+
+    return true;
+}   // end cellIds
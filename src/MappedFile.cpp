@@ -0,0 +1,108 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <MappedFile.h>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using RVTK::MappedFile;
+
+
+#ifdef _WIN32
+MappedFile::MappedFile( const std::string& fname, bool cow, Access access)
+    : _data(nullptr), _size(0), _cow(cow), _file(nullptr), _mapping(nullptr)
+{
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if ( access == SEQUENTIAL)
+        flags = FILE_FLAG_SEQUENTIAL_SCAN;
+    else if ( access == RANDOM)
+        flags = FILE_FLAG_RANDOM_ACCESS;
+    HANDLE fh = CreateFileA( fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if ( fh == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "[ERROR] RVTK::MappedFile: Unable to open " << fname << std::endl;
+        return;
+    }   // end if
+    _file = fh;
+
+    LARGE_INTEGER sz;
+    if ( !GetFileSizeEx( fh, &sz) || sz.QuadPart == 0)
+        return;
+    _mapping = CreateFileMappingA( fh, nullptr, cow ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if ( !_mapping)
+    {
+        std::cerr << "[ERROR] RVTK::MappedFile: Unable to map " << fname << std::endl;
+        return;
+    }   // end if
+    _data = static_cast<const char*>( MapViewOfFile( _mapping, cow ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if ( _data)
+        _size = size_t( sz.QuadPart);
+}   // end ctor
+
+
+MappedFile::~MappedFile()
+{
+    if ( _data)
+        UnmapViewOfFile( _data);
+    if ( _mapping)
+        CloseHandle( _mapping);
+    if ( _file)
+        CloseHandle( _file);
+}   // end dtor
+
+#else
+MappedFile::MappedFile( const std::string& fname, bool cow, Access access) : _data(nullptr), _size(0), _cow(cow)
+{
+    const int fd = open( fname.c_str(), O_RDONLY);
+    if ( fd < 0)
+    {
+        std::cerr << "[ERROR] RVTK::MappedFile: Unable to open " << fname << std::endl;
+        return;
+    }   // end if
+
+    struct stat st;
+    if ( fstat( fd, &st) == 0 && st.st_size > 0)
+    {
+        void* p = mmap( nullptr, size_t(st.st_size), cow ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( p != MAP_FAILED)
+        {
+            if ( access == SEQUENTIAL)
+                madvise( p, size_t(st.st_size), MADV_SEQUENTIAL);
+            else if ( access == RANDOM)
+                madvise( p, size_t(st.st_size), MADV_RANDOM);
+            _data = static_cast<const char*>(p);
+            _size = size_t(st.st_size);
+        }   // end if
+        else
+            std::cerr << "[ERROR] RVTK::MappedFile: Unable to map " << fname << std::endl;
+    }   // end if
+    close( fd); // The mapping remains valid
+}   // end ctor
+
+
+MappedFile::~MappedFile()
+{
+    if ( _data)
+        munmap( const_cast<char*>(_data), _size);
+}   // end dtor
+#endif
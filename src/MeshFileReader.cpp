@@ -0,0 +1,146 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include "MeshFileReader.h"
+#include "MeshReaders.h"
+#include <vtkCallbackCommand.h>
+#include <vtkInformationVector.h>
+#include <vtkPLYReader.h>
+#include <vtkSTLReader.h>
+#include <vtkOBJReader.h>
+#include <algorithm>
+#include <cctype>
+#include <string>
+using RVTK::MeshFileReader;
+
+vtkStandardNewMacro(MeshFileReader);
+
+
+namespace
+{
+
+// Forwards the progress of a fallback VTK reader to the MeshFileReader, passing on any abort.
+void forwardProgress( vtkObject* caller, unsigned long, void* clientData, void* callData)
+{
+   MeshFileReader* mfr = static_cast<MeshFileReader*>( clientData);
+   vtkAlgorithm* alg = static_cast<vtkAlgorithm*>( caller);
+   mfr->UpdateProgress( *static_cast<double*>( callData));
+   if ( mfr->GetAbortExecute())
+      alg->SetAbortExecute(1);
+}  // end forwardProgress
+
+}  // end namespace
+
+
+MeshFileReader::MeshFileReader() : FileName(nullptr), NumberOfThreads(0)
+{
+   this->SetNumberOfInputPorts(0);
+}  // end ctor
+
+
+MeshFileReader::~MeshFileReader()
+{
+   this->SetFileName(nullptr);
+}  // end dtor
+
+
+void MeshFileReader::PrintSelf( ostream& os, vtkIndent indent)
+{
+   this->Superclass::PrintSelf( os, indent);
+   os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << "\n";
+   os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}  // end PrintSelf
+
+
+int MeshFileReader::RequestData( vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector)
+{
+   if ( !this->FileName)
+   {
+      vtkErrorMacro( "A FileName must be specified.");
+      return 0;
+   }  // end if
+
+   const std::string fname = this->FileName;
+   const size_t dot = fname.rfind('.');
+   std::string lext = dot == std::string::npos ? "" : fname.substr(dot);
+   std::transform( lext.begin(), lext.end(), lext.begin(), ::tolower);
+
+   const size_t nthreads = size_t( std::max( 0, this->NumberOfThreads));
+   const RVTK::ReadProgressFn progress = [this]( float p)
+   {
+      this->UpdateProgress( p);
+      return !this->GetAbortExecute();
+   };  // end progress
+
+   vtkSmartPointer<vtkPolyData> pd;
+   vtkSmartPointer<vtkPolyDataAlgorithm> fallback;
+   if ( lext.compare( ".ply") == 0)
+   {
+      pd = RVTK::readBinaryPLY( fname, nthreads, progress);
+      if ( !pd)
+      {
+         vtkSmartPointer<vtkPLYReader> r = vtkSmartPointer<vtkPLYReader>::New();
+         r->SetFileName( this->FileName);
+         fallback = r;
+      }  // end if
+   }  // end if
+   else if ( lext.compare( ".stl") == 0)
+   {
+      pd = RVTK::readBinarySTL( fname, true, nthreads, progress);
+      if ( !pd)
+      {
+         vtkSmartPointer<vtkSTLReader> r = vtkSmartPointer<vtkSTLReader>::New();
+         r->SetFileName( this->FileName);
+         fallback = r;
+      }  // end if
+   }  // end else if
+   else if ( lext.compare( ".obj") == 0)
+   {
+      pd = RVTK::readOBJ( fname, nthreads, progress);
+      if ( !pd)
+      {
+         vtkSmartPointer<vtkOBJReader> r = vtkSmartPointer<vtkOBJReader>::New();
+         r->SetFileName( this->FileName);
+         fallback = r;
+      }  // end if
+   }  // end else if
+   else
+   {
+      vtkErrorMacro( "Unsupported mesh file extension: " << this->FileName);
+      return 0;
+   }  // end else
+
+   if ( this->GetAbortExecute())
+      return 0;
+
+   if ( !pd)
+   {
+      vtkSmartPointer<vtkCallbackCommand> cb = vtkSmartPointer<vtkCallbackCommand>::New();
+      cb->SetCallback( forwardProgress);
+      cb->SetClientData( this);
+      fallback->AddObserver( vtkCommand::ProgressEvent, cb);
+      fallback->Update();
+      if ( this->GetAbortExecute())
+         return 0;
+      pd = fallback->GetOutput();
+   }  // end if
+
+   vtkPolyData* output = vtkPolyData::GetData( outputVector->GetInformationObject(0));
+   output->ShallowCopy( pd);
+   this->UpdateProgress( 1.0);
+   return 1;
+}  // end RequestData
@@ -0,0 +1,806 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <MeshReaders.h>
+#include <MappedFile.h>
+#include <ParallelChunks.h>
+#include <NumberParser.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+bool isLittleEndian()
+{
+    const uint16_t v = 1;
+    unsigned char b;
+    memcpy( &b, &v, 1);
+    return b == 1;
+}   // end isLittleEndian
+
+
+// Load a value of type T from unaligned memory, reversing its bytes if swap is true.
+template <typename T>
+T loadAs( const char* p, bool swap)
+{
+    unsigned char b[sizeof(T)];
+    memcpy( b, p, sizeof(T));
+    if ( swap)
+        std::reverse( b, b + sizeof(T));
+    T v;
+    memcpy( &v, b, sizeof(T));
+    return v;
+}   // end loadAs
+
+
+vtkSmartPointer<vtkFloatArray> makePointsArray( size_t n)
+{
+    vtkSmartPointer<vtkFloatArray> pts = vtkSmartPointer<vtkFloatArray>::New();
+    pts->SetNumberOfComponents(3);
+    pts->SetNumberOfTuples( vtkIdType(n));
+    return pts;
+}   // end makePointsArray
+
+
+vtkSmartPointer<vtkIdTypeArray> makeCellsArray( size_t n)
+{
+    vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+    cells->SetNumberOfValues( vtkIdType(n));
+    return cells;
+}   // end makeCellsArray
+
+
+// Reports progress through the caller's function and tracks cancellation for a single read.
+class ReadMonitor
+{
+public:
+    explicit ReadMonitor( const RVTK::ReadProgressFn& fn) : _fn(fn), _cancelled(false) {}
+
+    // Report progress in [0,1] returning false if the read has been cancelled. Only call from the
+    // calling thread (which always processes the first chunk of a parallelChunks loop).
+    bool report( float p)
+    {
+        if ( !_cancelled && _fn && !_fn(p))
+            _cancelled = true;
+        return !_cancelled;
+    }   // end report
+
+    bool cancelled() const { return _cancelled;}
+
+    // Poll from iteration i of chunk c covering [b,e) of a parallelChunks loop. Every STEP iterations,
+    // the first chunk reports its progress (mapped into [p0,p1]) and the others check for cancellation.
+    // Returns false if the read has been cancelled.
+    bool poll( size_t c, size_t i, size_t b, size_t e, float p0, float p1)
+    {
+        if ( (i - b) % STEP != 0)
+            return true;
+        if ( c == 0)
+            return report( p0 + (p1 - p0) * float(i - b) / float(e - b));
+        return !_cancelled;
+    }   // end poll
+
+private:
+    static const size_t STEP = 1 << 15;
+    const RVTK::ReadProgressFn& _fn;
+    std::atomic<bool> _cancelled;
+};  // end class
+
+
+vtkSmartPointer<vtkPolyData> makePolyData( vtkFloatArray* pts, vtkIdTypeArray* cells, size_t ncells)
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData( pts);
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints( points);
+    if ( ncells > 0)
+    {
+        vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+        polys->SetCells( vtkIdType(ncells), cells);
+        pd->SetPolys( polys);
+    }   // end if
+    return pd;
+}   // end makePolyData
+
+
+/************************************** PLY **************************************/
+
+enum PlyType { PLY_INVALID=-1, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64};
+
+int plyTypeSize( int t)
+{
+    static const int SIZES[] = {1,1,2,2,4,4,4,8};
+    return t < 0 ? 0 : SIZES[t];
+}   // end plyTypeSize
+
+
+int plyType( const std::string& s)
+{
+    if ( s == "char" || s == "int8") return PLY_INT8;
+    if ( s == "uchar" || s == "uint8") return PLY_UINT8;
+    if ( s == "short" || s == "int16") return PLY_INT16;
+    if ( s == "ushort" || s == "uint16") return PLY_UINT16;
+    if ( s == "int" || s == "int32") return PLY_INT32;
+    if ( s == "uint" || s == "uint32") return PLY_UINT32;
+    if ( s == "float" || s == "float32") return PLY_FLOAT32;
+    if ( s == "double" || s == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+}   // end plyType
+
+
+double loadPly( const char* p, int t, bool swap)
+{
+    switch (t)
+    {
+        case PLY_INT8: return double( *reinterpret_cast<const int8_t*>(p));
+        case PLY_UINT8: return double( *reinterpret_cast<const uint8_t*>(p));
+        case PLY_INT16: return double( loadAs<int16_t>( p, swap));
+        case PLY_UINT16: return double( loadAs<uint16_t>( p, swap));
+        case PLY_INT32: return double( loadAs<int32_t>( p, swap));
+        case PLY_UINT32: return double( loadAs<uint32_t>( p, swap));
+        case PLY_FLOAT32: return double( loadAs<float>( p, swap));
+        case PLY_FLOAT64: return loadAs<double>( p, swap);
+    }   // end switch
+    return 0;
+}   // end loadPly
+
+
+struct PlyProperty
+{
+    std::string name;
+    int type;       // Value type (of list items if a list)
+    int countType;  // Type of the list count if a list
+    bool isList;
+};  // end struct
+
+
+struct PlyElement
+{
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> props;
+
+    // Record size or zero if records have list properties.
+    size_t fixedSize() const
+    {
+        size_t sz = 0;
+        for ( const PlyProperty& prop : props)
+        {
+            if ( prop.isList)
+                return 0;
+            sz += size_t( plyTypeSize( prop.type));
+        }   // end for
+        return sz;
+    }   // end fixedSize
+
+    int propIndex( const std::string& nm) const
+    {
+        for ( size_t i = 0; i < props.size(); ++i)
+            if ( props[i].name == nm)
+                return int(i);
+        return -1;
+    }   // end propIndex
+};  // end struct
+
+
+// Returns the position after the record of the given element starting at p or null if it overruns end.
+const char* skipRecord( const PlyElement& el, const char* p, const char* end, bool swap)
+{
+    for ( const PlyProperty& prop : el.props)
+    {
+        if ( prop.isList)
+        {
+            if ( p + plyTypeSize( prop.countType) > end)
+                return nullptr;
+            const size_t n = size_t( loadPly( p, prop.countType, swap));
+            p += size_t( plyTypeSize( prop.countType)) + n * size_t( plyTypeSize( prop.type));
+        }   // end if
+        else
+            p += plyTypeSize( prop.type);
+        if ( p > end)
+            return nullptr;
+    }   // end for
+    return p;
+}   // end skipRecord
+
+
+// Parse the PLY header returning the start of the body or null if not a binary PLY file.
+const char* parsePlyHeader( const char* data, size_t size, bool& swap, std::vector<PlyElement>& elements)
+{
+    static const std::string EH = "end_header";
+    if ( size < 3 || strncmp( data, "ply", 3) != 0)
+        return nullptr;
+    const char* end = data + size;
+    const char* eh = std::search( data, end, EH.begin(), EH.end());
+    if ( eh == end)
+        return nullptr;
+    const char* body = static_cast<const char*>( memchr( eh, '\n', size_t(end - eh)));
+    if ( !body)
+        return nullptr;
+    body++;
+
+    std::istringstream iss( std::string( data, eh));
+    std::string line;
+    bool binary = false;
+    while ( std::getline( iss, line))
+    {
+        std::istringstream liss( line);
+        std::string tok;
+        liss >> tok;
+        if ( tok == "format")
+        {
+            std::string fmt;
+            liss >> fmt;
+            if ( fmt == "binary_little_endian")
+                swap = !isLittleEndian();
+            else if ( fmt == "binary_big_endian")
+                swap = isLittleEndian();
+            else
+                return nullptr;  // ASCII
+            binary = true;
+        }   // end if
+        else if ( tok == "element")
+        {
+            PlyElement el;
+            liss >> el.name >> el.count;
+            elements.push_back( el);
+        }   // end else if
+        else if ( tok == "property")
+        {
+            if ( elements.empty())
+                return nullptr;
+            PlyProperty prop;
+            std::string t;
+            liss >> t;
+            prop.isList = t == "list";
+            prop.countType = PLY_INVALID;
+            if ( prop.isList)
+            {
+                std::string ct;
+                liss >> ct >> t;
+                prop.countType = plyType( ct);
+                if ( prop.countType == PLY_INVALID)
+                    return nullptr;
+            }   // end if
+            prop.type = plyType( t);
+            liss >> prop.name;
+            if ( prop.type == PLY_INVALID)
+                return nullptr;
+            elements.back().props.push_back( prop);
+        }   // end else if
+    }   // end while
+    return binary ? body : nullptr;
+}   // end parsePlyHeader
+
+
+/************************************** OBJ **************************************/
+
+using RVTK::skipSpace;
+using RVTK::parseFloat;
+using RVTK::parseInt;
+
+// Relative (negative) OBJ indices are stored as chunk local indices offset by this
+// (so always negative) until the number of vertices in preceding chunks is known.
+const int64_t LOCAL_OFFSET = int64_t(1) << 40;
+
+struct ObjChunk
+{
+    std::vector<float> vtxs;
+    std::vector<int64_t> cells; // Count followed by indices for each face
+    size_t nfaces;
+    bool ok;
+};  // end struct
+
+
+// Parse lines in [p,e) into chunk. Every so often the first chunk (c == 0) reports its progress
+// by bytes (mapped into [p0,p1]) and the others check for cancellation (leaving chunk.ok true).
+void parseObjChunk( const char* p, const char* e, ObjChunk& chunk, size_t c, ReadMonitor& mon, float p0, float p1)
+{
+    chunk.nfaces = 0;
+    chunk.ok = true;
+    std::vector<int64_t> face;
+    const char* b = p;
+    size_t nlines = 0;
+    while ( p < e)
+    {
+        if ( (nlines++ & 0xfff) == 0)
+        {
+            const bool go = c == 0 ? mon.report( p0 + (p1 - p0) * float(p - b) / float(e - b)) : !mon.cancelled();
+            if ( !go)
+                return;
+        }   // end if
+        const char* le = static_cast<const char*>( memchr( p, '\n', size_t(e - p)));
+        if ( !le)
+            le = e;
+        p = skipSpace( p, le);
+        if ( le - p >= 2 && (p[1] == ' ' || p[1] == '\t'))
+        {
+            if ( p[0] == 'v')
+            {
+                p += 2;
+                float x, y, z;
+                if ( !parseFloat( p, le, x) || !parseFloat( p, le, y) || !parseFloat( p, le, z))
+                {
+                    chunk.ok = false;
+                    return;
+                }   // end if
+                chunk.vtxs.push_back(x);
+                chunk.vtxs.push_back(y);
+                chunk.vtxs.push_back(z);
+            }   // end if
+            else if ( p[0] == 'f')
+            {
+                p += 2;
+                face.clear();
+                const int64_t nlocal = int64_t( chunk.vtxs.size() / 3);
+                int64_t idx;
+                while ( parseInt( p, le, idx))
+                {
+                    if ( idx > 0)
+                        face.push_back( idx - 1);
+                    else if ( idx < 0)
+                        face.push_back( nlocal + idx - LOCAL_OFFSET);
+                    else
+                    {
+                        chunk.ok = false;
+                        return;
+                    }   // end else
+                    while ( p < le && *p != ' ' && *p != '\t' && *p != '\r')  // Skip any /vt/vn
+                        ++p;
+                }   // end while
+                if ( face.size() >= 3)
+                {
+                    chunk.cells.push_back( int64_t( face.size()));
+                    chunk.cells.insert( chunk.cells.end(), face.begin(), face.end());
+                    chunk.nfaces++;
+                }   // end if
+            }   // end else if
+        }   // end if
+        p = le + 1;
+    }   // end while
+}   // end parseObjChunk
+
+
+/************************************** STL **************************************/
+
+const size_t STL_HEADER = 84;
+const size_t STL_RECORD = 50;
+
+// Sort in parallel by sorting chunks concurrently then merging pairs of runs concurrently.
+template <typename T, typename Less>
+void parallelSort( std::vector<T>& v, const Less& less, size_t nthreads)
+{
+    const size_t n = v.size();
+    const size_t MIN_CHUNK = 1 << 16;
+    const size_t nc = RVTK::numChunks( n, nthreads, MIN_CHUNK);
+    RVTK::parallelChunks( n, [&]( size_t, size_t b, size_t e){ std::sort( v.begin() + long(b), v.begin() + long(e), less);}, nc, MIN_CHUNK);
+
+    std::vector<size_t> bounds( nc+1);
+    for ( size_t c = 0; c <= nc; ++c)
+        bounds[c] = c*n/nc;
+    for ( size_t w = 1; w < nc; w *= 2)
+    {
+        std::vector<std::thread> threads;
+        for ( size_t c = 0; c + w < nc; c += 2*w)
+        {
+            const size_t b = bounds[c];
+            const size_t m = bounds[c+w];
+            const size_t e = bounds[std::min( c + 2*w, nc)];
+            threads.emplace_back( [&v, &less, b, m, e](){
+                std::inplace_merge( v.begin() + long(b), v.begin() + long(m), v.begin() + long(e), less);
+            });
+        }   // end for
+        for ( std::thread& t : threads)
+            t.join();
+    }   // end for
+}   // end parallelSort
+
+}   // end namespace
+
+
+vtkSmartPointer<vtkPolyData> RVTK::readBinaryPLY( const std::string& fname, size_t nthreads, const ReadProgressFn& progress)
+{
+    MappedFile mf( fname);
+    if ( !mf.isOpen())
+        return nullptr;
+
+    bool swap = false;
+    std::vector<PlyElement> elements;
+    const char* p = parsePlyHeader( mf.data(), mf.size(), swap, elements);
+    if ( !p)
+        return nullptr;
+    ReadMonitor mon( progress);
+    if ( !mon.report( 0.0f))
+        return nullptr;
+    const char* end = mf.data() + mf.size();
+
+    size_t nverts = 0;
+    for ( const PlyElement& el : elements)
+        if ( el.name == "vertex")
+            nverts = el.count;
+
+    vtkSmartPointer<vtkFloatArray> pts;
+    vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+    size_t ncells = 0;
+
+    for ( const PlyElement& el : elements)
+    {
+        const size_t stride = el.fixedSize();
+        if ( el.name == "vertex")
+        {
+            const int xi = el.propIndex("x");
+            const int yi = el.propIndex("y");
+            const int zi = el.propIndex("z");
+            if ( stride == 0 || xi < 0 || yi < 0 || zi < 0 || size_t(end - p) < el.count * stride)
+                return nullptr;
+
+            size_t offs[3] = {0,0,0};
+            int types[3];
+            const int idxs[3] = {xi, yi, zi};
+            for ( int k = 0; k < 3; ++k)
+            {
+                for ( int i = 0; i < idxs[k]; ++i)
+                    offs[k] += size_t( plyTypeSize( el.props[size_t(i)].type));
+                types[k] = el.props[size_t(idxs[k])].type;
+            }   // end for
+
+            pts = makePointsArray( el.count);
+            float* out = pts->GetPointer(0);
+            const char* base = p;
+            RVTK::parallelChunks( el.count, [&]( size_t c, size_t b, size_t e)
+            {
+                for ( size_t i = b; i < e && mon.poll( c, i, b, e, 0.0f, 0.5f); ++i)
+                {
+                    const char* rec = base + i*stride;
+                    for ( int k = 0; k < 3; ++k)
+                        out[3*i+size_t(k)] = float( loadPly( rec + offs[k], types[k], swap));
+                }   // end for
+            }, nthreads, 1 << 14);
+            if ( !mon.report( 0.5f))
+                return nullptr;
+            p += el.count * stride;
+        }   // end if
+        else if ( el.name == "face")
+        {
+            int li = el.propIndex("vertex_indices");
+            if ( li < 0)
+                li = el.propIndex("vertex_index");
+            if ( li < 0 || !el.props[size_t(li)].isList)
+                return nullptr;
+            const PlyProperty& lp = el.props[size_t(li)];
+            const size_t csz = size_t( plyTypeSize( lp.countType));
+            const size_t isz = size_t( plyTypeSize( lp.type));
+
+            // Fast path for faces that are all triangles with no other properties (fixed size records).
+            bool done = false;
+            const size_t tstride = csz + 3*isz;
+            if ( el.props.size() == 1 && el.count > 0 && size_t(end - p) >= el.count * tstride
+                    && loadPly( p, lp.countType, swap) == 3)
+            {
+                cells->SetNumberOfValues( vtkIdType(4 * el.count));
+                vtkIdType* out = cells->GetPointer(0);
+                std::atomic<bool> ok( true);
+                const char* base = p;
+                RVTK::parallelChunks( el.count, [&]( size_t c, size_t b, size_t e)
+                {
+                    for ( size_t i = b; i < e && ok && mon.poll( c, i, b, e, 0.5f, 1.0f); ++i)
+                    {
+                        const char* rec = base + i*tstride;
+                        if ( loadPly( rec, lp.countType, swap) != 3)
+                        {
+                            ok = false;
+                            return;
+                        }   // end if
+                        out[4*i] = 3;
+                        for ( size_t k = 0; k < 3; ++k)
+                        {
+                            const vtkIdType vid = vtkIdType( loadPly( rec + csz + k*isz, lp.type, swap));
+                            if ( vid < 0 || size_t(vid) >= nverts)
+                            {
+                                ok = false;
+                                return;
+                            }   // end if
+                            out[4*i+1+k] = vid;
+                        }   // end for
+                    }   // end for
+                }, nthreads, 1 << 14);
+
+                if ( mon.cancelled())
+                    return nullptr;
+                if ( ok)
+                {
+                    ncells = el.count;
+                    p += el.count * tstride;
+                    done = true;
+                }   // end if
+            }   // end if
+
+            if ( !done) // Arbitrary polygons or other properties so parse sequentially
+            {
+                std::vector<vtkIdType> cvec;
+                cvec.reserve( 4 * el.count);
+                for ( size_t i = 0; i < el.count; ++i)
+                {
+                    if ( !mon.poll( 0, i, 0, el.count, 0.5f, 1.0f))
+                        return nullptr;
+                    for ( size_t j = 0; j < el.props.size(); ++j)
+                    {
+                        const PlyProperty& prop = el.props[j];
+                        if ( !prop.isList)
+                        {
+                            p += plyTypeSize( prop.type);
+                            continue;
+                        }   // end if
+                        if ( p + csz > end)
+                            return nullptr;
+                        const size_t n = size_t( loadPly( p, prop.countType, swap));
+                        p += size_t( plyTypeSize( prop.countType));
+                        const size_t vsz = size_t( plyTypeSize( prop.type));
+                        if ( p + n*vsz > end)
+                            return nullptr;
+                        if ( int(j) == li)
+                        {
+                            cvec.push_back( vtkIdType(n));
+                            for ( size_t k = 0; k < n; ++k)
+                            {
+                                const vtkIdType vid = vtkIdType( loadPly( p + k*vsz, prop.type, swap));
+                                if ( vid < 0 || size_t(vid) >= nverts)
+                                {
+                                    std::cerr << "[ERROR] RVTK::readBinaryPLY: Invalid vertex index in " << fname << std::endl;
+                                    return nullptr;
+                                }   // end if
+                                cvec.push_back( vid);
+                            }   // end for
+                        }   // end if
+                        p += n*vsz;
+                    }   // end for
+                    if ( p > end)
+                        return nullptr;
+                }   // end for
+                cells->SetNumberOfValues( vtkIdType( cvec.size()));
+                std::copy( cvec.begin(), cvec.end(), cells->GetPointer(0));
+                ncells = el.count;
+            }   // end if
+        }   // end else if
+        else if ( stride > 0)
+            p += el.count * stride;
+        else
+        {
+            for ( size_t i = 0; i < el.count && p; ++i)
+                p = skipRecord( el, p, end, swap);
+        }   // end else
+        if ( !p || p > end)
+            return nullptr;
+    }   // end for
+
+    if ( !pts || !mon.report( 1.0f))
+        return nullptr;
+    return makePolyData( pts, cells, ncells);
+}   // end readBinaryPLY
+
+
+vtkSmartPointer<vtkPolyData> RVTK::readBinarySTL( const std::string& fname, bool mergePoints, size_t nthreads,
+                                                 const ReadProgressFn& progress)
+{
+    MappedFile mf( fname);
+    if ( !mf.isOpen() || mf.size() < STL_HEADER)
+        return nullptr;
+    const bool swap = !isLittleEndian();
+    const char* data = mf.data();
+    const size_t ntris = size_t( loadAs<uint32_t>( data + 80, swap));
+    if ( STL_HEADER + ntris * STL_RECORD != mf.size())
+        return nullptr;  // ASCII (or malformed)
+    ReadMonitor mon( progress);
+    if ( !mon.report( 0.0f))
+        return nullptr;
+
+    const size_t ncorners = 3*ntris;
+    // Position of the coordinates of the given triangle corner.
+    auto corner = [data]( size_t c){ return data + STL_HEADER + (c/3)*STL_RECORD + 12 + 12*(c%3);};
+
+    vtkSmartPointer<vtkIdTypeArray> cells = makeCellsArray( 4*ntris);
+    vtkIdType* cellOut = cells->GetPointer(0);
+
+    if ( !mergePoints)
+    {
+        vtkSmartPointer<vtkFloatArray> pts = makePointsArray( ncorners);
+        float* pout = pts->GetPointer(0);
+        RVTK::parallelChunks( ntris, [&]( size_t ch, size_t b, size_t e)
+        {
+            for ( size_t t = b; t < e && mon.poll( ch, t, b, e, 0.0f, 1.0f); ++t)
+            {
+                cellOut[4*t] = 3;
+                for ( size_t k = 0; k < 3; ++k)
+                {
+                    const size_t c = 3*t+k;
+                    const char* cp = corner(c);
+                    for ( size_t i = 0; i < 3; ++i)
+                        pout[3*c+i] = loadAs<float>( cp + 4*i, swap);
+                    cellOut[4*t+1+k] = vtkIdType(c);
+                }   // end for
+            }   // end for
+        }, nthreads, 1 << 14);
+        if ( !mon.report( 1.0f))
+            return nullptr;
+        return makePolyData( pts, cells, ntris);
+    }   // end if
+
+    // Group identical corners by sorting their indices on the bit patterns of their coordinates (any
+    // total order suffices to bring equal corners together). Adding zero turns -0 into +0 so the two
+    // zeros (which compare equal as floats, as vtkSTLReader's point merging treats them) are merged.
+    using CornerKey = std::array<uint32_t,3>;
+    auto key = [&corner, swap]( size_t c)
+    {
+        const char* cp = corner(c);
+        CornerKey k;
+        for ( size_t i = 0; i < 3; ++i)
+        {
+            const float f = loadAs<float>( cp + 4*i, swap) + 0.0f;
+            memcpy( &k[i], &f, 4);
+        }   // end for
+        return k;
+    };  // end key
+
+    std::vector<uint32_t> order( ncorners);
+    std::iota( order.begin(), order.end(), 0);
+    parallelSort( order, [&key]( uint32_t a, uint32_t b){ return key(a) < key(b);}, nthreads);
+    if ( !mon.report( 0.6f))
+        return nullptr;
+
+    std::vector<vtkIdType> remap( ncorners);
+    std::vector<uint32_t> uniq;   // Representative corner of each unique point
+    uniq.reserve( ncorners / 4);
+    for ( size_t i = 0; i < ncorners; ++i)
+    {
+        if ( i == 0 || key( order[i-1]) != key( order[i]))
+            uniq.push_back( order[i]);
+        remap[order[i]] = vtkIdType( uniq.size() - 1);
+    }   // end for
+    std::vector<uint32_t>().swap( order);
+    if ( !mon.report( 0.7f))
+        return nullptr;
+
+    vtkSmartPointer<vtkFloatArray> pts = makePointsArray( uniq.size());
+    float* pout = pts->GetPointer(0);
+    RVTK::parallelChunks( uniq.size(), [&]( size_t c, size_t b, size_t e)
+    {
+        for ( size_t i = b; i < e && mon.poll( c, i, b, e, 0.7f, 0.85f); ++i)
+        {
+            const char* cp = corner( uniq[i]);
+            for ( size_t k = 0; k < 3; ++k)
+                pout[3*i+k] = loadAs<float>( cp + 4*k, swap);
+        }   // end for
+    }, nthreads, 1 << 14);
+
+    RVTK::parallelChunks( ntris, [&]( size_t c, size_t b, size_t e)
+    {
+        for ( size_t t = b; t < e && mon.poll( c, t, b, e, 0.85f, 1.0f); ++t)
+        {
+            cellOut[4*t] = 3;
+            for ( size_t k = 0; k < 3; ++k)
+                cellOut[4*t+1+k] = remap[3*t+k];
+        }   // end for
+    }, nthreads, 1 << 14);
+
+    if ( !mon.report( 1.0f))
+        return nullptr;
+    return makePolyData( pts, cells, ntris);
+}   // end readBinarySTL
+
+
+vtkSmartPointer<vtkPolyData> RVTK::readOBJ( const std::string& fname, size_t nthreads, const ReadProgressFn& progress)
+{
+    MappedFile mf( fname);
+    if ( !mf.isOpen())
+        return nullptr;
+    const char* data = mf.data();
+    const size_t size = mf.size();
+    ReadMonitor mon( progress);
+    if ( !mon.report( 0.0f))
+        return nullptr;
+
+    // Chunk boundaries start at line beginnings.
+    const size_t nc = RVTK::numChunks( size, nthreads, 1 << 20);
+    std::vector<size_t> bounds( nc+1, size);
+    bounds[0] = 0;
+    for ( size_t c = 1; c < nc; ++c)
+    {
+        const size_t s = std::max( bounds[c-1], c*size/nc);
+        const char* nl = static_cast<const char*>( memchr( data + s, '\n', size - s));
+        bounds[c] = nl ? size_t(nl - data) + 1 : size;
+    }   // end for
+
+    std::vector<ObjChunk> chunks( nc);
+    RVTK::parallelChunks( nc, [&]( size_t, size_t b, size_t e)
+    {
+        for ( size_t c = b; c < e; ++c)
+            parseObjChunk( data + bounds[c], data + bounds[c+1], chunks[c], c, mon, 0.0f, 0.8f);
+    }, nc, 1);
+    if ( !mon.report( 0.8f))
+        return nullptr;
+
+    // Offsets of each chunk's vertices and cells.
+    std::vector<size_t> voffs( nc+1, 0), coffs( nc+1, 0);
+    size_t nfaces = 0;
+    for ( size_t c = 0; c < nc; ++c)
+    {
+        if ( !chunks[c].ok)
+        {
+            std::cerr << "[ERROR] RVTK::readOBJ: Unable to parse " << fname << std::endl;
+            return nullptr;
+        }   // end if
+        voffs[c+1] = voffs[c] + chunks[c].vtxs.size() / 3;
+        coffs[c+1] = coffs[c] + chunks[c].cells.size();
+        nfaces += chunks[c].nfaces;
+    }   // end for
+    const int64_t nverts = int64_t( voffs[nc]);
+    if ( nverts == 0)
+        return nullptr;
+
+    vtkSmartPointer<vtkFloatArray> pts = makePointsArray( size_t(nverts));
+    vtkSmartPointer<vtkIdTypeArray> cells = makeCellsArray( coffs[nc]);
+    float* pout = pts->GetPointer(0);
+    vtkIdType* cellOut = cells->GetPointer(0);
+    std::atomic<bool> ok( true);
+    RVTK::parallelChunks( nc, [&]( size_t, size_t b, size_t e)
+    {
+        for ( size_t c = b; c < e && !mon.cancelled(); ++c)
+        {
+            const ObjChunk& chunk = chunks[c];
+            std::copy( chunk.vtxs.begin(), chunk.vtxs.end(), pout + 3*voffs[c]);
+            vtkIdType* co = cellOut + coffs[c];
+            const size_t ncv = chunk.cells.size();
+            for ( size_t i = 0; i < ncv; )
+            {
+                const int64_t n = chunk.cells[i];
+                co[i++] = vtkIdType(n);
+                for ( int64_t k = 0; k < n; ++k, ++i)
+                {
+                    int64_t vid = chunk.cells[i];
+                    if ( vid < 0)
+                        vid += LOCAL_OFFSET + int64_t( voffs[c]);
+                    if ( vid < 0 || vid >= nverts)
+                        ok = false;
+                    co[i] = vtkIdType(vid);
+                }   // end for
+            }   // end for
+        }   // end for
+    }, nc, 1);
+
+    if ( !mon.report( 1.0f))
+        return nullptr;
+    if ( !ok)
+    {
+        std::cerr << "[ERROR] RVTK::readOBJ: Invalid vertex index in " << fname << std::endl;
+        return nullptr;
+    }   // end if
+    return makePolyData( pts, cells, nfaces);
+}   // end readOBJ
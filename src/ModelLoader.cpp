@@ -0,0 +1,218 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <ModelLoader.h>
+#include <ParallelChunks.h>
+#include <VtkActorCreator.h>
+#include <DataReader.h>
+#include <VtkTools.h>
+#include <vtkCallbackCommand.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkAlgorithm.h>
+#include <iostream>
+using RVTK::ModelLoader;
+using RVTK::LoadProgress;
+
+
+namespace {
+
+// Update progress and the callback (if given) returning false if the load has been cancelled.
+bool report( LoadProgress& lp, const ModelLoader::ProgressFn& fn, float p)
+{
+    lp.set( p);
+    if ( fn)
+        fn( p);
+    return !lp.cancelled();
+}   // end report
+
+
+// Forwards a VTK algorithm's progress (scaled into [p0,p1]) and aborts it if the load is cancelled.
+struct ProgressForwarder
+{
+    LoadProgress* lp;
+    const ModelLoader::ProgressFn* fn;
+    float p0, p1;
+
+    static void onProgress( vtkObject* caller, unsigned long, void* clientData, void* callData)
+    {
+        ProgressForwarder* pf = static_cast<ProgressForwarder*>(clientData);
+        const double vp = callData ? *static_cast<double*>(callData) : 0.0;
+        if ( !report( *pf->lp, *pf->fn, pf->p0 + float(vp) * (pf->p1 - pf->p0)))
+            vtkAlgorithm::SafeDownCast( caller)->SetAbortExecute(1);
+    }   // end onProgress
+};  // end struct
+
+
+vtkSmartPointer<vtkActor> loadFile( const std::string& fname, LoadProgress& lp, const ModelLoader::ProgressFn& fn)
+{
+    if ( !report( lp, fn, 0.0f))
+        return nullptr;
+
+    vtkSmartPointer<vtkPolyData> pd;
+    try
+    {
+        RVTK::DataReader reader( fname);
+        vtkAlgorithm* alg = reader.GetOutputPort()->GetProducer();
+        ProgressForwarder pf = {&lp, &fn, 0.0f, 0.6f};
+        vtkSmartPointer<vtkCallbackCommand> cb = vtkSmartPointer<vtkCallbackCommand>::New();
+        cb->SetCallback( &ProgressForwarder::onProgress);
+        cb->SetClientData( &pf);
+        const unsigned long tag = alg->AddObserver( vtkCommand::ProgressEvent, cb);
+        alg->Update();
+        alg->RemoveObserver( tag);
+        if ( lp.cancelled())
+            return nullptr;
+        pd = vtkPolyData::SafeDownCast( alg->GetOutputDataObject(0));
+    }   // end try
+    catch ( const RVTK::DataReaderException& e)
+    {
+        std::cerr << "[ERROR] RVTK::ModelLoader::load: " << e.what() << std::endl;
+        return nullptr;
+    }   // end catch
+
+    if ( !pd || pd->GetNumberOfPoints() == 0)
+    {
+        std::cerr << "[ERROR] RVTK::ModelLoader::load: Unable to read " << fname << std::endl;
+        return nullptr;
+    }   // end if
+
+    if ( !report( lp, fn, 0.6f))
+        return nullptr;
+    if ( !pd->GetPointData()->GetNormals() && pd->GetNumberOfPolys() > 0)
+        pd = RVTK::generateNormals( pd);
+    if ( !report( lp, fn, 0.9f))
+        return nullptr;
+
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData( pd);
+    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper( mapper);
+    report( lp, fn, 1.0f);
+    return actor;
+}   // end loadFile
+
+
+vtkSmartPointer<vtkActor> loadModel( const RFeatures::ObjModel::Ptr model, LoadProgress& lp, const ModelLoader::ProgressFn& fn)
+{
+    if ( !report( lp, fn, 0.0f))
+        return nullptr;
+    // Progress is reported between the polydata, normals and texture stages of generateActor.
+    vtkSmartPointer<vtkActor> actor = RVTK::VtkActorCreator::generateActor( *model, false, false,
+                                        [&]( float p){ return report( lp, fn, p);});
+    if ( !actor || !report( lp, fn, 1.0f))
+        return nullptr;
+    return actor;
+}   // end loadModel
+
+}   // end namespace
+
+
+ModelLoader::ModelLoader( size_t n) : _stop(false)
+{
+    if ( n == 0)
+        n = defaultThreadCount();
+    for ( size_t i = 0; i < n; ++i)
+        _threads.emplace_back( &ModelLoader::run, this);
+}   // end ctor
+
+
+ModelLoader::~ModelLoader()
+{
+    std::deque<Job> queued;
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _stop = true;
+        queued.swap( _jobs);
+    }
+    _cv.notify_all();
+    for ( Job& job : queued)
+        job( true);
+    for ( std::thread& t : _threads)
+        t.join();
+}   // end dtor
+
+
+size_t ModelLoader::pending() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _jobs.size();
+}   // end pending
+
+
+std::future<vtkSmartPointer<vtkActor> > ModelLoader::load( const std::string& fname, ProgressPtr* progress, const ProgressFn& fn)
+{
+    return enqueue( [fname]( LoadProgress& lp, const ProgressFn& pfn){ return loadFile( fname, lp, pfn);}, progress, fn);
+}   // end load
+
+
+std::future<vtkSmartPointer<vtkActor> > ModelLoader::load( const RFeatures::ObjModel::Ptr model, ProgressPtr* progress, const ProgressFn& fn)
+{
+    return enqueue( [model]( LoadProgress& lp, const ProgressFn& pfn){ return loadModel( model, lp, pfn);}, progress, fn);
+}   // end load
+
+
+// private
+std::future<vtkSmartPointer<vtkActor> > ModelLoader::enqueue(
+        const std::function<vtkSmartPointer<vtkActor>(LoadProgress&, const ProgressFn&)>& work, ProgressPtr* progress, const ProgressFn& fn)
+{
+    ProgressPtr lp = std::make_shared<LoadProgress>();
+    if ( progress)
+        *progress = lp;
+
+    using Promise = std::promise<vtkSmartPointer<vtkActor> >;
+    std::shared_ptr<Promise> promise = std::make_shared<Promise>();
+    std::future<vtkSmartPointer<vtkActor> > fut = promise->get_future();
+    Job job = [work, lp, fn, promise]( bool cancelled)
+    {
+        if ( cancelled)
+            lp->cancel();
+        try
+        {
+            promise->set_value( lp->cancelled() ? nullptr : work( *lp, fn));
+        }   // end try
+        catch (...)
+        {
+            promise->set_exception( std::current_exception());
+        }   // end catch
+    };
+
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _jobs.push_back( job);
+    }
+    _cv.notify_one();
+    return fut;
+}   // end enqueue
+
+
+// private
+void ModelLoader::run()
+{
+    while ( true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock( _mutex);
+            _cv.wait( lock, [this](){ return _stop || !_jobs.empty();});
+            if ( _jobs.empty())  // Only when stopping
+                return;
+            job = std::move( _jobs.front());
+            _jobs.pop_front();
+        }
+        job( false);
+    }   // end while
+}   // end run
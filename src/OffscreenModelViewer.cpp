@@ -18,12 +18,15 @@
 #include <OffscreenModelViewer.h>
 #include <VtkActorCreator.h>
 #include <ImageGrabber.h>
+#include <FrameCapture.h>
+#include <algorithm>
+#include <cmath>
 using RVTK::OffscreenModelViewer;
 using RFeatures::CameraParams;
 
 
 OffscreenModelViewer::OffscreenModelViewer( const cv::Size& dims, float rng)
-    : _actor(nullptr), _picker(nullptr)
+    : _actor(nullptr), _picker(nullptr), _nthreads(0)
 {
     _viewer = Viewer::create(true/*offscreen*/);
     _viewer->renderer()->UseFXAAOn();
@@ -46,6 +49,14 @@ void OffscreenModelViewer::setBackgroundColour( double r, double g, double b)
 }   // end setBackgroundColour
 
 
+void OffscreenModelViewer::setThreadCount( size_t n)
+{
+    _nthreads = n;
+    if ( _grabber)
+        _grabber->setThreadCount( n);
+}   // end setThreadCount
+
+
 void OffscreenModelViewer::setSize( const cv::Size& dims)
 {
     _viewer->setSize( static_cast<size_t>(dims.width), static_cast<size_t>(dims.height));
@@ -64,16 +75,39 @@ void OffscreenModelViewer::clear()
 }   // end clear
 
 
-void OffscreenModelViewer::setModel( const RFeatures::ObjModel& model)
+void OffscreenModelViewer::setModel( const RFeatures::ObjModel& model, size_t key)
 {
     clear();
-    // Create the actor
-    _actor = VtkActorCreator::generateActor( model);
+    if ( _cache)
+    {
+        if ( key == 0)
+            key = ActorCache::hash( model);
+        _actor = _cache->get( key);
+        if ( !_actor)
+        {
+            _actor = VtkActorCreator::generateActor( model);
+            if ( _actor)
+                _cache->put( key, _actor);
+        }   // end if
+    }   // end if
+    else
+        _actor = VtkActorCreator::generateActor( model);    // Create the actor
     _viewer->addActor( _actor);
     setCamera( _viewer->camera());  // Refresh
 }   // end setModel
 
 
+void OffscreenModelViewer::setActorCacheBudget( size_t bytes)
+{
+    if ( bytes == 0)
+        _cache.reset();
+    else if ( !_cache)
+        _cache.reset( new ActorCache( bytes));
+    else
+        _cache->setBudget( bytes);
+}   // end setActorCacheBudget
+
+
 void OffscreenModelViewer::setCamera( const CameraParams& cp)
 {
     _viewer->setCamera( cp);
@@ -84,18 +118,96 @@ void OffscreenModelViewer::setCamera( const CameraParams& cp)
 
 cv::Mat_<cv::Vec3b> OffscreenModelViewer::snapshot() const
 {
-    ImageGrabber ig(*_viewer);
-    return ig.colour();
+    ImageGrabber* ig = grabber();
+    ig->refresh();
+    return ig->colour().clone();
 }   // end snapshot
 
 
 cv::Mat_<byte> OffscreenModelViewer::lightnessSnapshot() const
 {
-    ImageGrabber ig(*_viewer);
-    return ig.light();
+    ImageGrabber* ig = grabber();
+    ig->refresh();
+    return ig->light().clone();
 }   // end lightnessSnapshot
 
 
+void OffscreenModelViewer::renderViews( const std::vector<CameraParams>& cps, std::vector<ViewImages>& views)
+{
+    ImageGrabber* ig = grabber();
+    views.resize( cps.size());
+    for ( size_t i = 0; i < cps.size(); ++i)
+    {
+        // Camera set without rendering since the grabber renders on refresh.
+        _viewer->setCamera( cps[i]);
+        _viewer->resetClippingRange();
+        ViewImages& vi = views[i];
+        ig->refresh( vi.colour, vi.light, vi.depth);
+    }   // end for
+}   // end renderViews
+
+
+int OffscreenModelViewer::renderTiled( const cv::Size& imgSize, const TileFn& fn)
+{
+    const cv::Size tsz = _viewer->size();
+    if ( imgSize.area() <= 0 || tsz.area() <= 0)
+        return 0;
+
+    // FXAA works on each tile's image alone which leaves seams at the tile edges so it's
+    // turned off for the tiles (and restored afterwards).
+    vtkRenderer* ren = _viewer->renderer();
+    const bool fxaa = ren->GetUseFXAA();
+    ren->UseFXAAOff();
+
+    vtkCamera* cam = ren->GetActiveCamera();
+    const double fov = cam->GetViewAngle();
+    double wcentre[2];
+    cam->GetWindowCenter( wcentre);
+
+    // Fix the clipping range for the full view so depth is consistent over the tiles.
+    _viewer->resetClippingRange();
+    const double cnear = _viewer->clipNear();
+    const double cfar = _viewer->clipFar();
+
+    // Vertical view angle of a tile such that tiles of the viewer's size exactly divide the full view.
+    const double halfTan = tan( 0.5 * fov * CV_PI / 180) * double(tsz.height) / imgSize.height;
+    cam->SetViewAngle( 2 * atan( halfTan) * 180 / CV_PI);
+
+    FrameCapture capture( *_viewer);
+    cv::Mat_<cv::Vec3b> colour;
+    cv::Mat_<float> depth;
+    int ntiles = 0;
+    bool proceed = true;
+    for ( int y = 0; y < imgSize.height && proceed; y += tsz.height)
+    {
+        for ( int x = 0; x < imgSize.width && proceed; x += tsz.width)
+        {
+            // Centre of the (uncropped) tile in the full view's normalised device coordinates
+            // scaled to the tile's own normalised device coordinates.
+            const double ox = (2.0 * (x + 0.5*tsz.width) / imgSize.width - 1.0) * imgSize.width / tsz.width;
+            const double oy = (1.0 - 2.0 * (y + 0.5*tsz.height) / imgSize.height) * imgSize.height / tsz.height;
+            cam->SetWindowCenter( ox, oy);
+            cam->SetClippingRange( cnear, cfar);
+            _viewer->updateRender();
+            capture.readColour( colour);
+            capture.readDepth( depth);
+
+            const cv::Rect rect( x, y, std::min( tsz.width, imgSize.width - x), std::min( tsz.height, imgSize.height - y));
+            const cv::Rect trect( 0, 0, rect.width, rect.height);
+            proceed = fn( rect, colour(trect), depth(trect));
+            ntiles++;
+        }   // end for
+    }   // end for
+
+    cam->SetWindowCenter( wcentre[0], wcentre[1]);
+    cam->SetViewAngle( fov);
+    ren->SetUseFXAA( fxaa);
+    _viewer->resetClippingRange();
+    _viewer->updateRender();
+    return ntiles;
+}   // end renderTiled
+
+
 bool OffscreenModelViewer::pick( const cv::Point2f& p) const
 {
     return picker()->pickActor(p) != nullptr;
@@ -122,3 +234,14 @@ RVTK::RendererPicker* OffscreenModelViewer::picker() const
         _picker = new RendererPicker( _viewer->renderer(), RendererPicker::TOP_LEFT);
     return _picker;
 }   // end picker
+
+
+RVTK::ImageGrabber* OffscreenModelViewer::grabber() const
+{
+    if ( !_grabber)
+    {
+        _grabber.reset( new ImageGrabber( *_viewer));
+        _grabber->setThreadCount( _nthreads);
+    }   // end if
+    return _grabber.get();
+}   // end grabber
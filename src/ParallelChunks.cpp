@@ -0,0 +1,57 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <ParallelChunks.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+size_t RVTK::defaultThreadCount()
+{
+    const size_t n = std::thread::hardware_concurrency();
+    return std::max<size_t>( 1, n);
+}   // end defaultThreadCount
+
+
+size_t RVTK::numChunks( size_t n, size_t nthreads, size_t minChunk)
+{
+    if ( nthreads == 0)
+        nthreads = defaultThreadCount();
+    minChunk = std::max<size_t>( 1, minChunk);
+    return std::max<size_t>( 1, std::min( nthreads, n / minChunk));
+}   // end numChunks
+
+
+size_t RVTK::parallelChunks( size_t n, const ChunkFn& fn, size_t nthreads, size_t minChunk)
+{
+    const size_t nchunks = numChunks( n, nthreads, minChunk);
+    if ( nchunks == 1)
+    {
+        fn( 0, 0, n);
+        return 1;
+    }   // end if
+
+    std::vector<std::thread> threads;
+    threads.reserve( nchunks-1);
+    for ( size_t c = 1; c < nchunks; ++c)
+        threads.emplace_back( fn, c, c*n/nchunks, (c+1)*n/nchunks);
+    fn( 0, 0, n/nchunks);
+    for ( std::thread& t : threads)
+        t.join();
+    return nchunks;
+}   // end parallelChunks
@@ -0,0 +1,224 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include "PointReader.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "ParallelChunks.h"
+#include <vtkInformationVector.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using RVTK::PointReader;
+
+vtkStandardNewMacro(PointReader);
+
+
+namespace
+{
+
+// Return the start of the line following the one containing the byte at pos (or size if none).
+size_t nextLineStart( const char* data, size_t size, size_t pos)
+{
+   if ( pos == 0 || pos >= size)
+      return std::min( pos, size);
+   const char* nl = static_cast<const char*>( memchr( data + pos, '\n', size - pos));
+   return nl ? size_t(nl - data) + 1 : size;
+}  // end nextLineStart
+
+
+// Upper bound on the number of lines in [b,e).
+size_t countLines( const char* b, const char* e)
+{
+   size_t n = size_t( std::count( b, e, '\n'));
+   if ( e > b && *(e-1) != '\n')
+      n++;
+   return n;
+}  // end countLines
+
+
+// Parse the point lines in [p,e) into pts and cols returning the number of points parsed.
+size_t parsePoints( const char* p, const char* e, float* pts, unsigned char* cols)
+{
+   size_t n = 0;
+   while ( p < e)
+   {
+      const char* le = static_cast<const char*>( memchr( p, '\n', size_t(e - p)));
+      if ( !le)
+         le = e;
+
+      float* v = &pts[3*n];
+      if ( RVTK::parseFloat( p, le, v[0]) && RVTK::parseFloat( p, le, v[1]) && RVTK::parseFloat( p, le, v[2]))
+      {
+         unsigned char* c = &cols[3*n];
+         float rgb[3] = {255,255,255};
+         if ( RVTK::parseFloat( p, le, rgb[0]) && RVTK::parseFloat( p, le, rgb[1]))
+            RVTK::parseFloat( p, le, rgb[2]);
+         for ( int k = 0; k < 3; ++k)
+            c[k] = static_cast<unsigned char>( std::min( 255.0f, std::max( 0.0f, rgb[k] + 0.5f)));
+         n++;
+      }  // end if
+      p = le + 1;
+   }  // end while
+   return n;
+}  // end parsePoints
+
+}  // end namespace
+
+
+PointReader::PointReader() : FileName(nullptr), GenerateVertices(true), NumberOfThreads(0)
+{
+   this->SetNumberOfInputPorts(0);
+}  // end ctor
+
+
+PointReader::~PointReader()
+{
+   this->SetFileName(nullptr);
+}  // end dtor
+
+
+void PointReader::PrintSelf( ostream& os, vtkIndent indent)
+{
+   this->Superclass::PrintSelf( os, indent);
+   os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << "\n";
+   os << indent << "GenerateVertices: " << this->GenerateVertices << "\n";
+   os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}  // end PrintSelf
+
+
+int PointReader::RequestInformation( vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector)
+{
+   vtkInformation* outInfo = outputVector->GetInformationObject(0);
+   outInfo->Set( CAN_HANDLE_PIECE_REQUEST(), 1);
+   return 1;
+}  // end RequestInformation
+
+
+int PointReader::RequestData( vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector)
+{
+   if ( !this->FileName)
+   {
+      vtkErrorMacro( "A FileName must be specified.");
+      return 0;
+   }  // end if
+
+   vtkInformation* outInfo = outputVector->GetInformationObject(0);
+   vtkPolyData* output = vtkPolyData::GetData( outInfo);
+   int piece = 0;
+   int npieces = 1;
+   if ( outInfo->Has( vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER()))
+      piece = outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
+   if ( outInfo->Has( vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()))
+      npieces = std::max( 1, outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()));
+
+   RVTK::MappedFile mf( this->FileName);
+   if ( !mf.isOpen())
+   {
+      vtkErrorMacro( "Unable to read " << this->FileName);
+      return 0;
+   }  // end if
+   const char* data = mf.data();
+   const size_t size = mf.size();
+
+   // Byte range of the requested piece with both ends on line starts.
+   const size_t pbeg = nextLineStart( data, size, size_t( double(size) * piece / npieces));
+   const size_t pend = nextLineStart( data, size, size_t( double(size) * (piece+1) / npieces));
+   const size_t plen = pend > pbeg ? pend - pbeg : 0;
+
+   // Chunks of the piece for each thread, also on line starts.
+   const size_t nc = RVTK::numChunks( plen, size_t( std::max( 0, this->NumberOfThreads)), 1 << 20);
+   std::vector<size_t> bounds( nc+1, pend);
+   bounds[0] = pbeg;
+   for ( size_t c = 1; c < nc; ++c)
+      bounds[c] = std::max( bounds[c-1], nextLineStart( data, size, pbeg + c*plen/nc));
+
+   // Count lines to preallocate each chunk's space then parse straight into the arrays.
+   std::vector<size_t> caps( nc+1, 0), counts( nc, 0);
+   RVTK::parallelChunks( nc, [&]( size_t, size_t b, size_t e)
+   {
+      for ( size_t c = b; c < e; ++c)
+         caps[c+1] = countLines( data + bounds[c], data + bounds[c+1]);
+   }, nc, 1);
+   for ( size_t c = 0; c < nc; ++c)
+      caps[c+1] += caps[c];
+
+   vtkSmartPointer<vtkFloatArray> pts = vtkSmartPointer<vtkFloatArray>::New();
+   pts->SetNumberOfComponents(3);
+   pts->SetNumberOfTuples( vtkIdType( caps[nc]));
+   vtkSmartPointer<vtkUnsignedCharArray> cols = vtkSmartPointer<vtkUnsignedCharArray>::New();
+   cols->SetName( "RGB");
+   cols->SetNumberOfComponents(3);
+   cols->SetNumberOfTuples( vtkIdType( caps[nc]));
+   float* pout = pts->GetPointer(0);
+   unsigned char* colOut = cols->GetPointer(0);
+
+   RVTK::parallelChunks( nc, [&]( size_t, size_t b, size_t e)
+   {
+      for ( size_t c = b; c < e; ++c)
+         counts[c] = parsePoints( data + bounds[c], data + bounds[c+1], pout + 3*caps[c], colOut + 3*caps[c]);
+   }, nc, 1);
+   this->UpdateProgress( 0.8);
+
+   // Close the gaps left by lines that weren't points.
+   size_t npts = counts.empty() ? 0 : counts[0];
+   for ( size_t c = 1; c < nc; ++c)
+   {
+      if ( npts != caps[c])
+      {
+         memmove( pout + 3*npts, pout + 3*caps[c], 3*counts[c]*sizeof(float));
+         memmove( colOut + 3*npts, colOut + 3*caps[c], 3*counts[c]);
+      }  // end if
+      npts += counts[c];
+   }  // end for
+   if ( npts != caps[nc])
+   {
+      pts->Resize( vtkIdType(npts));
+      pts->SetNumberOfTuples( vtkIdType(npts));
+      cols->Resize( vtkIdType(npts));
+      cols->SetNumberOfTuples( vtkIdType(npts));
+   }  // end if
+
+   vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+   points->SetData( pts);
+   output->SetPoints( points);
+   output->GetPointData()->SetScalars( cols);
+
+   if ( this->GenerateVertices)
+   {
+      vtkSmartPointer<vtkIdTypeArray> vids = vtkSmartPointer<vtkIdTypeArray>::New();
+      vids->SetNumberOfValues( vtkIdType(2*npts));
+      vtkIdType* vout = vids->GetPointer(0);
+      RVTK::parallelChunks( npts, [vout]( size_t, size_t b, size_t e)
+      {
+         for ( size_t i = b; i < e; ++i)
+         {
+            vout[2*i] = 1;
+            vout[2*i+1] = vtkIdType(i);
+         }  // end for
+      }, size_t( std::max( 0, this->NumberOfThreads)), 1 << 16);
+      vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+      verts->SetCells( vtkIdType(npts), vids);
+      output->SetVerts( verts);
+   }  // end if
+
+   this->UpdateProgress( 1.0);
+   return 1;
+}  // end RequestData
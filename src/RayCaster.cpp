@@ -0,0 +1,362 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <RayCaster.h>
+#include <ParallelChunks.h>
+#include <VtkTools.h>
+#include <vtkPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkMatrix4x4.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+using RVTK::RayCaster;
+using RVTK::RayHit;
+using RFeatures::ObjModel;
+
+
+namespace {
+
+const int MAX_LEAF_TRIS = 4;
+const int MAX_STACK = 128;
+
+cv::Vec3f transform( const cv::Matx44d& m, const cv::Vec3f& v)
+{
+    const cv::Vec4d p = m * cv::Vec4d( v[0], v[1], v[2], 1.0);
+    return cv::Vec3f( float(p[0]), float(p[1]), float(p[2]));
+}   // end transform
+
+
+// Slab test returning the entry distance along the ray if the box is hit before tmax.
+bool hitBox( const cv::Vec3f& bmin, const cv::Vec3f& bmax, const cv::Vec3f& o, const cv::Vec3f& inv, float tmax, float& tnear)
+{
+    float t0 = 0.0f;
+    float t1 = tmax;
+    for ( int a = 0; a < 3; ++a)
+    {
+        float ta = (bmin[a] - o[a]) * inv[a];
+        float tb = (bmax[a] - o[a]) * inv[a];
+        if ( ta > tb)
+            std::swap( ta, tb);
+        t0 = std::max( t0, ta);
+        t1 = std::min( t1, tb);
+        if ( t0 > t1)
+            return false;
+    }   // end for
+    tnear = t0;
+    return true;
+}   // end hitBox
+
+}   // end namespace
+
+
+RayCaster::RayCaster() : _dirty(false) {}
+
+
+void RayCaster::clear()
+{
+    _tris.clear();
+    _nodes.clear();
+    _actors.clear();
+    _dirty = false;
+}   // end clear
+
+
+// private
+void RayCaster::addTriangle( const cv::Vec3f& v0, const cv::Vec3f& v1, const cv::Vec3f& v2, int mesh, int cellId)
+{
+    Triangle t;
+    t.v0 = v0;
+    t.e1 = v1 - v0;
+    t.e2 = v2 - v0;
+    t.mesh = mesh;
+    t.cellId = cellId;
+    _tris.push_back(t);
+    _dirty = true;
+}   // end addTriangle
+
+
+void RayCaster::add( const ObjModel& model, vtkActor* actor)
+{
+    assert( model.hasSequentialIds());
+    const int mesh = static_cast<int>(_actors.size());
+    _actors.push_back( actor);
+
+    const cv::Matx44d& T = model.transformMatrix();
+    const int nv = model.numVtxs();
+    std::vector<cv::Vec3f> vtxs(nv);
+    for ( int i = 0; i < nv; ++i)
+        vtxs[i] = transform( T, model.uvtx(i));
+
+    const int nf = model.numPolys();
+    _tris.reserve( _tris.size() + nf);
+    for ( int fid = 0; fid < nf; ++fid)
+    {
+        const int* fvidxs = model.fvidxs(fid);
+        addTriangle( vtxs[fvidxs[0]], vtxs[fvidxs[1]], vtxs[fvidxs[2]], mesh, fid);
+    }   // end for
+}   // end add
+
+
+void RayCaster::add( vtkActor* actor)
+{
+    vtkPolyData* pd = RVTK::getPolyData( actor);
+    if ( !pd || !pd->GetPolys())
+        return;
+
+    const int mesh = static_cast<int>(_actors.size());
+    _actors.push_back( actor);
+
+    const cv::Matx44d T = RVTK::toCV( actor->GetMatrix());
+    vtkPoints* points = pd->GetPoints();
+    const int np = static_cast<int>(points->GetNumberOfPoints());
+    std::vector<cv::Vec3f> vtxs(np);
+    double p[3];
+    for ( int i = 0; i < np; ++i)
+    {
+        points->GetPoint( i, p);
+        vtxs[i] = transform( T, cv::Vec3f( float(p[0]), float(p[1]), float(p[2])));
+    }   // end for
+
+    // Polygon cell IDs follow any vertex and line cells in the polydata.
+    int cellId = static_cast<int>(pd->GetNumberOfVerts() + pd->GetNumberOfLines());
+    vtkCellArray* polys = pd->GetPolys();
+    _tris.reserve( _tris.size() + polys->GetNumberOfCells());
+    polys->InitTraversal();
+    vtkIdType npts;
+    vtkIdType *vidxs;
+    while ( polys->GetNextCell( npts, vidxs) > 0)
+    {
+        for ( vtkIdType j = 2; j < npts; ++j)
+            addTriangle( vtxs[vidxs[0]], vtxs[vidxs[j-1]], vtxs[vidxs[j]], mesh, cellId);
+        cellId++;
+    }   // end while
+}   // end add
+
+
+// private
+void RayCaster::buildNode( int nidx, std::vector<int>& tidxs, const std::vector<cv::Vec3f>& cents, int b, int e)
+{
+    cv::Vec3f bmin( FLT_MAX, FLT_MAX, FLT_MAX);
+    cv::Vec3f bmax( -FLT_MAX, -FLT_MAX, -FLT_MAX);
+    cv::Vec3f cmin = bmin;
+    cv::Vec3f cmax = bmax;
+    for ( int i = b; i < e; ++i)
+    {
+        const Triangle& t = _tris[tidxs[i]];
+        const cv::Vec3f vs[3] = { t.v0, t.v0 + t.e1, t.v0 + t.e2};
+        const cv::Vec3f& c = cents[tidxs[i]];
+        for ( int a = 0; a < 3; ++a)
+        {
+            for ( int j = 0; j < 3; ++j)
+            {
+                bmin[a] = std::min( bmin[a], vs[j][a]);
+                bmax[a] = std::max( bmax[a], vs[j][a]);
+            }   // end for
+            cmin[a] = std::min( cmin[a], c[a]);
+            cmax[a] = std::max( cmax[a], c[a]);
+        }   // end for
+    }   // end for
+
+    _nodes[nidx].bmin = bmin;
+    _nodes[nidx].bmax = bmax;
+
+    const cv::Vec3f ext = cmax - cmin;
+    if ( e - b <= MAX_LEAF_TRIS || (ext[0] <= 0 && ext[1] <= 0 && ext[2] <= 0))
+    {
+        _nodes[nidx].first = b;
+        _nodes[nidx].count = e - b;
+        return;
+    }   // end if
+
+    // Split at the median centroid along the longest axis of the centroid bounds.
+    const int axis = ext[0] > ext[1] ? (ext[0] > ext[2] ? 0 : 2) : (ext[1] > ext[2] ? 1 : 2);
+    const int m = (b + e) / 2;
+    std::nth_element( tidxs.begin() + b, tidxs.begin() + m, tidxs.begin() + e,
+                      [&]( int i, int j){ return cents[i][axis] < cents[j][axis];});
+
+    // Children are stored adjacently so only the index of the left child is needed.
+    const int left = static_cast<int>(_nodes.size());
+    _nodes.resize( _nodes.size() + 2);
+    _nodes[nidx].first = left;
+    _nodes[nidx].count = 0;
+    buildNode( left, tidxs, cents, b, m);
+    buildNode( left+1, tidxs, cents, m, e);
+}   // end buildNode
+
+
+void RayCaster::build()
+{
+    _nodes.clear();
+    _dirty = false;
+    const int n = static_cast<int>(_tris.size());
+    if ( n == 0)
+        return;
+
+    std::vector<cv::Vec3f> cents(n);
+    std::vector<int> tidxs(n);
+    for ( int i = 0; i < n; ++i)
+    {
+        const Triangle& t = _tris[i];
+        cents[i] = t.v0 + (t.e1 + t.e2) * (1.0f/3);
+        tidxs[i] = i;
+    }   // end for
+
+    _nodes.reserve( 4*size_t(n)/MAX_LEAF_TRIS + 1);
+    _nodes.resize(1);
+    buildNode( 0, tidxs, cents, 0, n);
+
+    // Reorder the triangles so each leaf references a contiguous range.
+    std::vector<Triangle> tris(n);
+    for ( int i = 0; i < n; ++i)
+        tris[i] = _tris[tidxs[i]];
+    _tris.swap( tris);
+}   // end build
+
+
+// private
+RayHit RayCaster::castBuilt( const cv::Vec3f& o, const cv::Vec3f& dir) const
+{
+    RayHit hit;
+    if ( _nodes.empty())
+        return hit;
+
+    const cv::Vec3f d = dir * (1.0f / static_cast<float>(cv::norm(dir)));
+    const cv::Vec3f inv( 1.0f/d[0], 1.0f/d[1], 1.0f/d[2]);
+    float tbest = FLT_MAX;
+    int tidx = -1;
+
+    int stack[MAX_STACK];
+    int sp = 0;
+    float tnear;
+    if ( hitBox( _nodes[0].bmin, _nodes[0].bmax, o, inv, tbest, tnear))
+        stack[sp++] = 0;
+
+    while ( sp > 0)
+    {
+        const Node& node = _nodes[stack[--sp]];
+        if ( node.count > 0)
+        {
+            // Moller-Trumbore intersection with each triangle in the leaf.
+            for ( int i = node.first; i < node.first + node.count; ++i)
+            {
+                const Triangle& t = _tris[i];
+                const cv::Vec3f p = d.cross( t.e2);
+                const float det = t.e1.dot( p);
+                if ( fabsf( det) < 1e-12f)
+                    continue;
+                const float idet = 1.0f/det;
+                const cv::Vec3f s = o - t.v0;
+                const float u = s.dot( p) * idet;
+                if ( u < 0.0f || u > 1.0f)
+                    continue;
+                const cv::Vec3f q = s.cross( t.e1);
+                const float v = d.dot( q) * idet;
+                if ( v < 0.0f || u + v > 1.0f)
+                    continue;
+                const float tt = t.e2.dot( q) * idet;
+                if ( tt > 0.0f && tt < tbest)
+                {
+                    tbest = tt;
+                    tidx = i;
+                }   // end if
+            }   // end for
+        }   // end if
+        else
+        {
+            // Push the further child first so the nearer one is visited next.
+            float tl, tr;
+            const Node& l = _nodes[node.first];
+            const Node& r = _nodes[node.first+1];
+            const bool hl = hitBox( l.bmin, l.bmax, o, inv, tbest, tl);
+            const bool hr = hitBox( r.bmin, r.bmax, o, inv, tbest, tr);
+            if ( hl && hr)
+            {
+                if ( tl <= tr)
+                {
+                    stack[sp++] = node.first+1;
+                    stack[sp++] = node.first;
+                }   // end if
+                else
+                {
+                    stack[sp++] = node.first;
+                    stack[sp++] = node.first+1;
+                }   // end else
+            }   // end if
+            else if ( hl)
+                stack[sp++] = node.first;
+            else if ( hr)
+                stack[sp++] = node.first+1;
+            assert( sp < MAX_STACK);
+        }   // end else
+    }   // end while
+
+    if ( tidx >= 0)
+    {
+        const Triangle& t = _tris[tidx];
+        hit.actor = _actors[t.mesh];
+        hit.cellId = t.cellId;
+        hit.pos = o + d * tbest;
+        cv::normalize( t.e1.cross( t.e2), hit.normal);
+    }   // end if
+    return hit;
+}   // end castBuilt
+
+
+RayHit RayCaster::cast( const cv::Vec3f& origin, const cv::Vec3f& dir) const
+{
+    if ( _dirty)
+        const_cast<RayCaster*>(this)->build();
+    return castBuilt( origin, dir);
+}   // end cast
+
+
+size_t RayCaster::cast( const RFeatures::CameraParams& cp, const cv::Size& sz, const std::vector<cv::Point2f>& pts,
+                        std::vector<RayHit>& hits, size_t nthreads) const
+{
+    if ( _dirty)
+        const_cast<RayCaster*>(this)->build();
+
+    // Camera basis with the up vector made orthogonal to the view direction.
+    cv::Vec3f fwd, right, up;
+    cv::normalize( cp.focus - cp.pos, fwd);
+    cv::normalize( fwd.cross( cp.up), right);
+    up = right.cross( fwd);
+    const float th = static_cast<float>( tan( cp.fov * CV_PI / 360.0));   // Tangent of half the vertical FoV
+    const float tw = th * float(sz.width) / sz.height;
+
+    const size_t n = pts.size();
+    hits.resize( n);
+    std::vector<size_t> nhits( numChunks( n, nthreads));
+    parallelChunks( n, [&]( size_t c, size_t b, size_t e)
+    {
+        for ( size_t i = b; i < e; ++i)
+        {
+            const float x = 2.0f * pts[i].x - 1.0f;   // Right positive
+            const float y = 1.0f - 2.0f * pts[i].y;   // Up positive
+            hits[i] = castBuilt( cp.pos, fwd + right * (x * tw) + up * (y * th));
+            if ( hits[i].cellId >= 0)
+                nhits[c]++;
+        }   // end for
+    }, nthreads);
+
+    size_t total = 0;
+    for ( size_t h : nhits)
+        total += h;
+    return total;
+}   // end cast
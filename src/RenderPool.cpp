@@ -0,0 +1,98 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <RenderPool.h>
+#include <ParallelChunks.h>
+#include <memory>
+using RVTK::RenderPool;
+using RVTK::ViewImages;
+using RVTK::OffscreenModelViewer;
+using RFeatures::CameraParams;
+
+
+RenderPool::RenderPool( const cv::Size& dims, size_t n, float rng)
+    : _dims(dims), _rng(rng), _stop(false)
+{
+    if ( n == 0)
+        n = defaultThreadCount();
+    for ( size_t i = 0; i < n; ++i)
+        _threads.emplace_back( &RenderPool::run, this);
+}   // end ctor
+
+
+RenderPool::~RenderPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for ( std::thread& t : _threads)
+        t.join();
+}   // end dtor
+
+
+size_t RenderPool::pending() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _jobs.size();
+}   // end pending
+
+
+std::future<std::vector<ViewImages> > RenderPool::submit( const RFeatures::ObjModel::Ptr model,
+                                                          const std::vector<CameraParams>& cps)
+{
+    using Task = std::packaged_task<std::vector<ViewImages>(OffscreenModelViewer&)>;
+    std::shared_ptr<Task> task = std::make_shared<Task>( [model, cps]( OffscreenModelViewer& viewer)
+    {
+        std::vector<ViewImages> views;
+        viewer.setModel( *model);
+        viewer.renderViews( cps, views);
+        viewer.clear();
+        return views;
+    });
+
+    std::future<std::vector<ViewImages> > fut = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _jobs.push_back( [task]( OffscreenModelViewer& viewer){ (*task)( viewer);});
+    }
+    _cv.notify_one();
+    return fut;
+}   // end submit
+
+
+// private
+void RenderPool::run()
+{
+    // The viewer (and its render context) is created, used and destroyed only on this thread.
+    OffscreenModelViewer viewer( _dims, _rng);
+    viewer.setThreadCount(1);   // The pool's contexts already occupy the cores
+    while ( true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock( _mutex);
+            _cv.wait( lock, [this](){ return _stop || !_jobs.empty();});
+            if ( _jobs.empty())  // Only when stopping
+                return;
+            job = std::move( _jobs.front());
+            _jobs.pop_front();
+        }
+        job( viewer);
+    }   // end while
+}   // end run
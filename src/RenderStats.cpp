@@ -0,0 +1,215 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <RenderStats.h>
+#include <VtkTools.h>
+#include <vtkActorCollection.h>
+#include <vtkTexture.h>
+#include <vtkImageData.h>
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+using RVTK::RenderStats;
+using RVTK::FrameStats;
+
+
+RenderStats::RenderStats( size_t window) : _window( std::max<size_t>( 1, window)), _total(0), _t0( Clock::now()), _frameStart(0)
+{}   // end ctor
+
+
+double RenderStats::now() const
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - _t0).count();
+}   // end now
+
+
+void RenderStats::beginFrame() { _frameStart = now();}
+
+
+void RenderStats::endFrame( vtkRenderer* ren)
+{
+    FrameStats fs;
+    fs.startMs = _frameStart;
+    fs.wallMs = now() - _frameStart;
+    fs.renderMs = ren ? 1000 * ren->GetLastRenderTimeInSeconds() : 0;
+    fs.readbackMs = 0;
+    fs.triangles = fs.points = fs.meshUpdates = fs.textureUpdates = 0;
+
+    if ( ren)
+    {
+        // Compare modification times against the previous frame's, keeping only actors seen this frame.
+        std::unordered_map<const void*, vtkMTimeType> meshTimes, textureTimes;
+        vtkActorCollection* actors = ren->GetActors();
+        vtkCollectionSimpleIterator ait;
+        actors->InitTraversal( ait);
+        while ( vtkActor* actor = actors->GetNextActor( ait))
+        {
+            if ( !actor->GetVisibility())
+                continue;
+            vtkPolyData* pd = RVTK::getPolyData( actor);
+            if ( pd)
+            {
+                fs.triangles += size_t( pd->GetNumberOfPolys());
+                fs.points += size_t( pd->GetNumberOfPoints());
+                const vtkMTimeType mt = pd->GetMTime();
+                auto it = _meshTimes.find( pd);
+                if ( it == _meshTimes.end() || it->second != mt)
+                    fs.meshUpdates++;
+                meshTimes[pd] = mt;
+            }   // end if
+
+            vtkTexture* tx = actor->GetTexture();
+            if ( tx)
+            {
+                vtkMTimeType mt = tx->GetMTime();
+                if ( tx->GetInput())
+                    mt = std::max( mt, tx->GetInput()->GetMTime());
+                auto it = _textureTimes.find( tx);
+                if ( it == _textureTimes.end() || it->second != mt)
+                    fs.textureUpdates++;
+                textureTimes[tx] = mt;
+            }   // end if
+        }   // end while
+        _meshTimes.swap( meshTimes);
+        _textureTimes.swap( textureTimes);
+    }   // end if
+
+    _frames.push_back( fs);
+    while ( _frames.size() > _window)
+        _frames.pop_front();
+    _total++;
+}   // end endFrame
+
+
+void RenderStats::addReadback( double ms)
+{
+    if ( !_frames.empty())
+        _frames.back().readbackMs += ms;
+}   // end addReadback
+
+
+void RenderStats::setWindow( size_t w)
+{
+    _window = std::max<size_t>( 1, w);
+    while ( _frames.size() > _window)
+        _frames.pop_front();
+}   // end setWindow
+
+
+double RenderStats::percentile( double p, double FrameStats::* field) const
+{
+    if ( _frames.empty())
+        return 0;
+    std::vector<double> vals;
+    vals.reserve( _frames.size());
+    for ( const FrameStats& fs : _frames)
+        vals.push_back( fs.*field);
+    const double prop = std::min( 100.0, std::max( 0.0, p)) / 100;
+    const size_t k = std::min( vals.size() - 1, size_t( prop * (vals.size() - 1) + 0.5));
+    std::nth_element( vals.begin(), vals.begin() + long(k), vals.end());
+    return vals[k];
+}   // end percentile
+
+
+namespace {
+
+// Sets fixed point notation with microsecond resolution (for millisecond values) on the stream
+// for its lifetime so large timestamps aren't written in scientific notation, then restores it.
+class FixedFormat
+{
+public:
+    explicit FixedFormat( std::ostream& os) : _os(os), _flags(os.flags()), _prec(os.precision())
+    {
+        _os << std::fixed << std::setprecision(3);
+    }   // end ctor
+    ~FixedFormat()
+    {
+        _os.flags( _flags);
+        _os.precision( _prec);
+    }   // end dtor
+private:
+    std::ostream& _os;
+    const std::ios::fmtflags _flags;
+    const std::streamsize _prec;
+};  // end class
+
+
+void writeSummary( std::ostream& os, const RenderStats& stats, const char* name, double FrameStats::* field)
+{
+    os << "\"" << name << "\":{\"p50\":" << stats.percentile( 50, field)
+       << ",\"p95\":" << stats.percentile( 95, field)
+       << ",\"p99\":" << stats.percentile( 99, field) << "}";
+}   // end writeSummary
+
+}   // end namespace
+
+
+void RenderStats::writeJSON( std::ostream& os) const
+{
+    const FixedFormat fmt( os);
+    os << "{\"totalFrames\":" << _total << ",\"window\":" << _frames.size() << ",";
+    writeSummary( os, *this, "wallMs", &FrameStats::wallMs);
+    os << ",";
+    writeSummary( os, *this, "renderMs", &FrameStats::renderMs);
+    os << ",";
+    writeSummary( os, *this, "readbackMs", &FrameStats::readbackMs);
+    os << ",\"frames\":[";
+    for ( size_t i = 0; i < _frames.size(); ++i)
+    {
+        const FrameStats& fs = _frames[i];
+        os << (i > 0 ? "," : "")
+           << "{\"startMs\":" << fs.startMs << ",\"wallMs\":" << fs.wallMs
+           << ",\"renderMs\":" << fs.renderMs << ",\"readbackMs\":" << fs.readbackMs
+           << ",\"triangles\":" << fs.triangles << ",\"points\":" << fs.points
+           << ",\"meshUpdates\":" << fs.meshUpdates << ",\"textureUpdates\":" << fs.textureUpdates << "}";
+    }   // end for
+    os << "]}" << std::endl;
+}   // end writeJSON
+
+
+void RenderStats::writeTrace( std::ostream& os) const
+{
+    // Complete ("X") events with timestamps and durations in microseconds.
+    const FixedFormat fmt( os);
+    os << "{\"traceEvents\":[";
+    for ( size_t i = 0; i < _frames.size(); ++i)
+    {
+        const FrameStats& fs = _frames[i];
+        os << (i > 0 ? "," : "")
+           << "{\"name\":\"render\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+           << ",\"ts\":" << 1000 * fs.startMs << ",\"dur\":" << 1000 * fs.wallMs
+           << ",\"args\":{\"renderMs\":" << fs.renderMs << ",\"triangles\":" << fs.triangles
+           << ",\"points\":" << fs.points << ",\"meshUpdates\":" << fs.meshUpdates
+           << ",\"textureUpdates\":" << fs.textureUpdates << "}}";
+        if ( fs.readbackMs > 0)
+        {
+            os << ",{\"name\":\"readback\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+               << ",\"ts\":" << 1000 * (fs.startMs + fs.wallMs) << ",\"dur\":" << 1000 * fs.readbackMs << "}";
+        }   // end if
+    }   // end for
+    os << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}   // end writeTrace
+
+
+void RenderStats::clear()
+{
+    _frames.clear();
+    _meshTimes.clear();
+    _textureTimes.clear();
+    _total = 0;
+    _t0 = Clock::now();
+}   // end clear
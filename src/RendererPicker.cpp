@@ -16,13 +16,17 @@
  ************************************************************************/
 
 #include <RendererPicker.h>
-#include <vtkCellPicker.h>
-#include <vtkPropPicker.h>
-#include <vtkWorldPointPicker.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActorCollection.h>
 #include <vtkCoordinate.h>
+#include <vtkHardwareSelector.h>
+#include <vtkPropCollection.h>
+#include <vtkNew.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <functional>
+#include <climits>
 using RVTK::RendererPicker;
 using RVTK::ActorSubset;
 
@@ -34,14 +38,120 @@ cv::Point RendererPicker::toPxls( const cv::Point2f& p) const
 }   // end toPxls
 
 
+// private
+bool RendererPicker::locatorsChanged() const
+{
+    if ( _propsMTime != _ren->GetViewProps()->GetMTime())   // Props added or removed
+        return true;
+    for ( const auto& lit : _locators)
+    {
+        const CellLocator& cl = lit.second;
+        vtkActor* actor = cl.actor;
+        if ( !actor)    // Deleted
+            return true;
+        vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast( actor->GetMapper());
+        vtkPolyData* pd = mapper ? mapper->GetInput() : nullptr;
+        if ( pd != cl.pd.GetPointer() || (pd && pd->GetMTime() > cl.buildTime))
+            return true;
+    }   // end for
+    return false;
+}   // end locatorsChanged
+
+
+// private
+vtkCellPicker* RendererPicker::cellPicker() const
+{
+    if ( !locatorsChanged())
+        return _cellPicker;
+
+    // Ensure there's an up to date locator for every polydata actor in the renderer
+    // and drop the locators of actors that are no longer present. Actors without cells
+    // are kept (without a locator) so cells being added to them is noticed.
+    std::unordered_map<vtkActor*, CellLocator> locators;
+    _cellPicker->RemoveAllLocators();
+    _normalPicker->RemoveAllLocators();
+    _propsMTime = _ren->GetViewProps()->GetMTime();
+    vtkActorCollection* actors = _ren->GetActors();
+    vtkCollectionSimpleIterator ait;
+    actors->InitTraversal( ait);
+    while ( vtkActor* actor = actors->GetNextActor( ait))
+    {
+        vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast( actor->GetMapper());
+        vtkPolyData* pd = mapper ? mapper->GetInput() : nullptr;
+
+        CellLocator cl;
+        auto it = _locators.find( actor);
+        // The weak pointer to the actor is null if the cached actor was deleted (and its address reused).
+        if ( it != _locators.end() && it->second.actor.GetPointer() == actor && it->second.pd.GetPointer() == pd)
+            cl = it->second;
+        else
+        {
+            cl.actor = actor;
+            cl.pd = pd;
+            cl.buildTime = 0;
+        }   // end else
+
+        if ( pd && pd->GetNumberOfCells() > 0)
+        {
+            if ( !cl.tree)
+            {
+                cl.tree = vtkSmartPointer<vtkModifiedBSPTree>::New();
+                cl.tree->SetDataSet( pd);
+            }   // end if
+            if ( cl.buildTime < pd->GetMTime())
+            {
+                cl.tree->BuildLocator();
+                cl.buildTime = pd->GetMTime();
+            }   // end if
+            _cellPicker->AddLocator( cl.tree);
+            _normalPicker->AddLocator( cl.tree);
+        }   // end if
+        else
+        {
+            cl.tree = nullptr;
+            cl.buildTime = pd ? pd->GetMTime() : 0;
+        }   // end else
+
+        locators[actor] = cl;
+    }   // end while
+
+    _locators.swap( locators);
+    return _cellPicker;
+}   // end cellPicker
+
+
+// private
+vtkCellPicker* RendererPicker::normalPicker() const
+{
+    cellPicker();   // Updates the locators on both pickers
+    return _normalPicker;
+}   // end normalPicker
+
+
 // public
 RendererPicker::RendererPicker( vtkRenderer* ren, PointOrigin po, double t)
-    : _ren(ren), _pointOrigin(po), _tolerance(t)
+    : _ren(ren), _pointOrigin(po), _tolerance(t),
+      _cellPicker( vtkSmartPointer<vtkCellPicker>::New()),
+      _normalPicker( vtkSmartPointer<vtkCellPicker>::New()),     // Keeps VTK's default tolerance
+      _propPicker( vtkSmartPointer<vtkPropPicker>::New()),
+      _worldPicker( vtkSmartPointer<vtkWorldPointPicker>::New()),  // Hardware accelerated
+      _propsMTime(0)
 {
     _ren->ResetCameraClippingRange();
+    _cellPicker->SetTolerance( _tolerance);
 }   // end ctor
 
 
+// public
+void RendererPicker::clearLocators()
+{
+    _locators.clear();
+    _propsMTime = 0;
+    _cellPicker->RemoveAllLocators();
+    _normalPicker->RemoveAllLocators();
+}   // end clearLocators
+
+
 namespace {
 cv::Point changeOriginOfPoint( vtkRenderer* ren, const cv::Point& p, RendererPicker::PointOrigin po)
 {
@@ -61,9 +171,8 @@ cv::Point changeOriginOfPoint( vtkRenderer* ren, const cv::Point& p, RendererPic
 // public
 int RendererPicker::pickActorCells( const std::vector<cv::Point>& points2d, std::vector<ActorSubset>& picked) const
 {
-    vtkSmartPointer<vtkCellPicker> cellPicker = vtkSmartPointer<vtkCellPicker>::New();
-    vtkSmartPointer<vtkPropPicker> propPicker = vtkSmartPointer<vtkPropPicker>::New();
-    cellPicker->SetTolerance( _tolerance);
+    vtkCellPicker* cellPicker = this->cellPicker();
+    vtkPropPicker* propPicker = _propPicker;
 
     std::unordered_map<vtkActor*, std::unordered_set<int> > actorCells;
     for ( const cv::Point& p : points2d)
@@ -102,11 +211,10 @@ int RendererPicker::pickActorCells( const std::vector<cv::Point>& points2d,
     if ( !actor)
         return 0;
 
-    vtkSmartPointer<vtkCellPicker> cellPicker = vtkSmartPointer<vtkCellPicker>::New();
-    vtkSmartPointer<vtkPropPicker> propPicker = vtkSmartPointer<vtkPropPicker>::New();
+    vtkCellPicker* cellPicker = this->cellPicker();
+    vtkPropPicker* propPicker = _propPicker;
     vtkSmartPointer<vtkPropCollection> pickFrom = vtkSmartPointer<vtkPropCollection>::New();
     pickFrom->AddItem(actor);
-    cellPicker->SetTolerance( _tolerance);
 
     std::unordered_set<int> setCellIds;   // Avoid duplicate cell IDs being picked
     for ( const cv::Point& p : points2d)
@@ -125,14 +233,157 @@ int RendererPicker::pickActorCells( const std::vector<cv::Point>& points2d,
 }   // end pickActorCells
 
 
+namespace {
+
+// Render the renderer's pickable props into ID buffers covering the bounding rectangle of the given
+// points and call fn with the actor and cell ID found at each point (if any). Returns false if
+// the buffers could not be captured.
+bool selectCells( vtkRenderer* ren, const std::vector<cv::Point>& points2d, RendererPicker::PointOrigin po,
+                  const std::function<void(vtkActor*, int)>& fn)
+{
+    if ( points2d.empty())
+        return true;
+
+    // Points are relative to the renderer's viewport but the selector works in display
+    // (render window) coordinates so offset by the viewport's origin.
+    const int* rsz = ren->GetSize();
+    const int* rorg = ren->GetOrigin();
+    std::vector<cv::Point> npts;
+    npts.reserve( points2d.size());
+    cv::Point minp( INT_MAX, INT_MAX);
+    cv::Point maxp( INT_MIN, INT_MIN);
+    for ( const cv::Point& p : points2d)
+    {
+        cv::Point np = changeOriginOfPoint( ren, p, po);
+        if ( np.x < 0 || np.y < 0 || np.x >= rsz[0] || np.y >= rsz[1])
+            continue;
+        np.x += rorg[0];
+        np.y += rorg[1];
+        npts.push_back(np);
+        minp.x = std::min( minp.x, np.x);
+        minp.y = std::min( minp.y, np.y);
+        maxp.x = std::max( maxp.x, np.x);
+        maxp.y = std::max( maxp.y, np.y);
+    }   // end for
+
+    if ( npts.empty())
+        return true;
+
+    vtkNew<vtkHardwareSelector> selector;
+    selector->SetRenderer( ren);
+    selector->SetFieldAssociation( vtkDataObject::FIELD_ASSOCIATION_CELLS);
+    selector->SetArea( minp.x, minp.y, maxp.x, maxp.y);
+    if ( !selector->CaptureBuffers())
+        return false;
+
+    unsigned int dpos[2];
+    for ( const cv::Point& np : npts)
+    {
+        dpos[0] = static_cast<unsigned int>(np.x);
+        dpos[1] = static_cast<unsigned int>(np.y);
+        const vtkHardwareSelector::PixelInformation info = selector->GetPixelInformation( dpos, 0);
+        if ( info.Valid)
+        {
+            vtkActor* actor = vtkActor::SafeDownCast( info.Prop);
+            if ( actor)
+                fn( actor, static_cast<int>(info.AttributeID));
+        }   // end if
+    }   // end for
+
+    selector->ClearBuffers();
+    return true;
+}   // end selectCells
+
+
+// Makes every pickable prop of a renderer other than the given one unpickable for its lifetime
+// so the scene is restored however the scope is left.
+class OtherPropsUnpickable
+{
+public:
+    OtherPropsUnpickable( vtkRenderer* ren, const vtkProp* keep)
+    {
+        vtkPropCollection* props = ren->GetViewProps();
+        vtkCollectionSimpleIterator pit;
+        props->InitTraversal( pit);
+        while ( vtkProp* prop = props->GetNextProp( pit))
+        {
+            if ( prop != keep && prop->GetPickable())
+            {
+                _props.push_back( prop);
+                prop->PickableOff();
+            }   // end if
+        }   // end while
+    }   // end ctor
+
+    ~OtherPropsUnpickable()
+    {
+        for ( vtkProp* prop : _props)
+            prop->PickableOn();
+    }   // end dtor
+
+private:
+    std::vector<vtkSmartPointer<vtkProp> > _props;
+
+    OtherPropsUnpickable( const OtherPropsUnpickable&) = delete;
+    void operator=( const OtherPropsUnpickable&) = delete;
+};  // end class
+
+}   // end namespace
+
+
+// public
+int RendererPicker::pickActorCellsBatched( const std::vector<cv::Point>& points2d, std::vector<ActorSubset>& picked) const
+{
+    std::unordered_map<vtkActor*, std::unordered_set<int> > actorCells;
+    if ( !selectCells( _ren, points2d, _pointOrigin, [&]( vtkActor* a, int cid){ actorCells[a].insert(cid);}))
+        return -1;
+
+    for ( const auto& pickedActor : actorCells)
+    {
+        picked.resize( picked.size() + 1);
+        ActorSubset& actorSubset = *picked.rbegin();
+        actorSubset.actor = pickedActor.first;
+        actorSubset.cellIds.insert( actorSubset.cellIds.end(), pickedActor.second.begin(), pickedActor.second.end());
+    }   // end for
+
+    return static_cast<int>(actorCells.size());
+}   // end pickActorCellsBatched
+
+
+// public
+int RendererPicker::pickActorCellsBatched( const std::vector<cv::Point>& points2d,
+                                           vtkActor* actor, std::vector<int>& cellIds) const
+{
+    if ( !actor)
+        return 0;
+
+    std::unordered_set<int> setCellIds;   // Avoid duplicate cell IDs being picked
+    bool ok = false;
+    {
+        // Every other prop is unpickable only while the ID buffers are rendered.
+        const OtherPropsUnpickable unpickable( _ren, actor);
+        ok = selectCells( _ren, points2d, _pointOrigin, [&]( vtkActor* a, int cid)
+        {
+            if ( a == actor)
+                setCellIds.insert(cid);
+        });
+    }
+
+    if ( !ok)
+        return -1;
+
+    cellIds.insert( cellIds.end(), setCellIds.begin(), setCellIds.end());
+    return static_cast<int>(setCellIds.size());
+}   // end pickActorCellsBatched
+
+
 // public
 vtkActor* RendererPicker::pickActor( const cv::Point& p) const
 {
     const cv::Point np = changeOriginOfPoint( _ren, p, _pointOrigin);
-    vtkNew<vtkPropPicker> ppicker;
     vtkActor* act = nullptr;
-    if ( ppicker->PickProp( np.x, np.y, _ren) > 0)
-        act = ppicker->GetActor();
+    if ( _propPicker->PickProp( np.x, np.y, _ren) > 0)
+        act = _propPicker->GetActor();
     return act;
 }   // end pickActor
 
@@ -160,10 +411,10 @@ vtkSmartPointer<vtkPropCollection> createPropCollection( const std::vector<vtkSm
 }   // end createPropCollection
 */
 
-vtkActor* pick( const cv::Point& p, vtkSmartPointer<vtkPropCollection> pickFrom, vtkRenderer* ren, RendererPicker::PointOrigin po)
+vtkActor* pick( const cv::Point& p, vtkSmartPointer<vtkPropCollection> pickFrom, vtkRenderer* ren,
+                RendererPicker::PointOrigin po, vtkPropPicker* propPicker)
 {
     const cv::Point np = changeOriginOfPoint( ren, p, po);
-    vtkSmartPointer<vtkPropPicker> propPicker = vtkSmartPointer<vtkPropPicker>::New();
     propPicker->PickProp( np.x, np.y, ren, pickFrom);
     vtkActor* act = propPicker->GetActor();
     return act;
@@ -175,7 +426,7 @@ vtkActor* pick( const cv::Point& p, vtkSmartPointer<vtkPropCollection> pickFrom,
 // public
 vtkActor* RendererPicker::pickActor( const cv::Point& p, const std::vector<vtkActor*>& possActors) const
 {
-    return pick( p, createPropCollection( possActors), _ren, _pointOrigin);
+    return pick( p, createPropCollection( possActors), _ren, _pointOrigin, _propPicker);
 }   // end pickActor
 
 
@@ -187,8 +438,7 @@ vtkActor* RendererPicker::pickActor( const cv::Point2f& p, const std::vector<vtk
 int RendererPicker::pickCell( const cv::Point& p) const
 {
     const cv::Point np = changeOriginOfPoint( _ren, p, _pointOrigin);
-    vtkSmartPointer<vtkCellPicker> picker = vtkSmartPointer<vtkCellPicker>::New();
-    picker->SetTolerance( _tolerance);
+    vtkCellPicker* picker = cellPicker();
     picker->Pick( np.x, np.y, 0, _ren);
     const int cid = picker->GetCellId();
     return cid;
@@ -203,9 +453,8 @@ int RendererPicker::pickCell( const cv::Point2f& p) const { return pickCell( toP
 cv::Vec3f RendererPicker::pickWorldPosition( const cv::Point& p) const
 {
     const cv::Point np = changeOriginOfPoint( _ren, p, _pointOrigin);
-    vtkSmartPointer<vtkWorldPointPicker> picker = vtkSmartPointer<vtkWorldPointPicker>::New();   // Hardware accelerated
-    picker->Pick( np.x, np.y, 0, _ren);
-    const double* wpos = picker->GetPickPosition();
+    _worldPicker->Pick( np.x, np.y, 0, _ren);
+    const double* wpos = _worldPicker->GetPickPosition();
     const cv::Vec3f v( (float)wpos[0], (float)wpos[1], (float)wpos[2]);
     return v;
 }   // end pickWorldPosition
@@ -220,7 +469,7 @@ cv::Vec3f RendererPicker::pickWorldPosition( const cv::Point2f& p) const { retur
 cv::Vec3f RendererPicker::pickNormal( const cv::Point& p) const
 {
     const cv::Point np = changeOriginOfPoint( _ren, p, _pointOrigin);
-    vtkSmartPointer<vtkCellPicker> picker = vtkSmartPointer<vtkCellPicker>::New();
+    vtkCellPicker* picker = normalPicker();
     cv::Vec3f v(0,0,0);
     if ( picker->Pick( np.x, np.y, 0, _ren))
     {
@@ -0,0 +1,247 @@
+/************************************************************************
+ * Copyright (C) 2019 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include <SnapshotEncoder.h>
+#include <ParallelChunks.h>
+#include <iostream>
+using RVTK::SnapshotEncoder;
+
+
+SnapshotEncoder::SnapshotEncoder( size_t n, size_t maxQueued)
+    : _maxQueue( std::max<size_t>( 1, maxQueued)), _stop(false), _active(0),
+      _maxDepth(0), _written(0), _dropped(0), _failed(0), _videoOpen(false), _nextSeq(0), _videoSeq(0)
+{
+    if ( n == 0)
+        n = defaultThreadCount();
+    for ( size_t i = 0; i < n; ++i)
+        _threads.emplace_back( &SnapshotEncoder::run, this);
+}   // end ctor
+
+
+SnapshotEncoder::~SnapshotEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for ( std::thread& t : _threads)
+        t.join();
+    std::lock_guard<std::mutex> vlock( _videoMutex);
+    _video.release();
+}   // end dtor
+
+
+bool SnapshotEncoder::write( const cv::Mat& img, const std::string& fname)
+{
+    if ( img.empty() || fname.empty())
+        return false;
+    Job job;
+    job.img = img;
+    job.fname = fname;
+    job.seq = 0;
+    return enqueue( std::move(job));
+}   // end write
+
+
+bool SnapshotEncoder::openVideo( const std::string& fname, double fps, const cv::Size& sz, int fourcc)
+{
+    closeVideo();
+    std::lock_guard<std::mutex> vlock( _videoMutex);
+    if ( !_video.open( fname, fourcc, fps, sz))
+    {
+        std::cerr << "[ERROR] RVTK::SnapshotEncoder::openVideo: Unable to open " << fname << std::endl;
+        return false;
+    }   // end if
+    _videoSeq = 0;
+    _videoSize = sz;
+    std::lock_guard<std::mutex> lock( _mutex);
+    _nextSeq = 0;
+    _videoOpen = true;
+    return true;
+}   // end openVideo
+
+
+void SnapshotEncoder::closeVideo()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        _videoOpen = false; // No more frames accepted
+    }
+    flush();
+    std::lock_guard<std::mutex> vlock( _videoMutex);
+    _video.release();
+}   // end closeVideo
+
+
+bool SnapshotEncoder::isVideoOpen() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _videoOpen;
+}   // end isVideoOpen
+
+
+bool SnapshotEncoder::writeFrame( const cv::Mat& img)
+{
+    if ( img.empty())
+        return false;
+    Job job;
+    job.img = img;
+    return enqueue( std::move(job));
+}   // end writeFrame
+
+
+void SnapshotEncoder::flush()
+{
+    std::unique_lock<std::mutex> lock( _mutex);
+    _doneCv.wait( lock, [this](){ return _jobs.empty() && _active == 0;});
+}   // end flush
+
+
+size_t SnapshotEncoder::queued() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _jobs.size();
+}   // end queued
+
+
+size_t SnapshotEncoder::maxQueued() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _maxDepth;
+}   // end maxQueued
+
+
+size_t SnapshotEncoder::written() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _written;
+}   // end written
+
+
+size_t SnapshotEncoder::dropped() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _dropped;
+}   // end dropped
+
+
+size_t SnapshotEncoder::failed() const
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    return _failed;
+}   // end failed
+
+
+void SnapshotEncoder::resetStats()
+{
+    std::lock_guard<std::mutex> lock( _mutex);
+    _maxDepth = _jobs.size();
+    _written = _dropped = _failed = 0;
+}   // end resetStats
+
+
+// private
+bool SnapshotEncoder::enqueue( Job&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex);
+        const bool isVideo = job.fname.empty();
+        if ( isVideo && !_videoOpen)
+            return false;
+        if ( _jobs.size() >= _maxQueue)
+        {
+            _dropped++;
+            return false;
+        }   // end if
+        if ( isVideo)
+            job.seq = _nextSeq++;
+        _jobs.push_back( std::move(job));
+        _maxDepth = std::max( _maxDepth, _jobs.size());
+    }
+    _cv.notify_one();
+    return true;
+}   // end enqueue
+
+
+// private
+void SnapshotEncoder::run()
+{
+    while ( true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock( _mutex);
+            _cv.wait( lock, [this](){ return _stop || !_jobs.empty();});
+            if ( _jobs.empty())  // Only when stopping
+                return;
+            job = std::move( _jobs.front());
+            _jobs.pop_front();
+            _active++;
+        }
+
+        bool ok = true;
+        if ( !job.fname.empty())
+        {
+            // imwrite throws (rather than returning false) for some failures (e.g. unknown extension).
+            try
+            {
+                ok = cv::imwrite( job.fname, job.img);
+            }   // end try
+            catch ( const cv::Exception& e)
+            {
+                std::cerr << "[ERROR] RVTK::SnapshotEncoder: Unable to write " << job.fname << ": " << e.what() << std::endl;
+                ok = false;
+            }   // end catch
+        }   // end if
+        else
+        {
+            // Video frames are taken from the queue in order but may be taken by different threads
+            // so wait for the preceding frame to be written (its thread already has it) to keep order.
+            // VideoWriter::write silently drops frames not of the size the video was opened with.
+            {
+                std::unique_lock<std::mutex> vlock( _videoMutex);
+                _videoCv.wait( vlock, [&](){ return _videoSeq == job.seq;});
+                ok = _video.isOpened() && job.img.size() == _videoSize;
+                if ( ok)
+                {
+                    try
+                    {
+                        _video.write( job.img);
+                    }   // end try
+                    catch ( const cv::Exception& e)
+                    {
+                        std::cerr << "[ERROR] RVTK::SnapshotEncoder: Unable to write video frame: " << e.what() << std::endl;
+                        ok = false;
+                    }   // end catch
+                }   // end if
+                _videoSeq++;
+            }
+            _videoCv.notify_all();
+        }   // end else
+
+        {
+            std::lock_guard<std::mutex> lock( _mutex);
+            _active--;
+            if ( ok)
+                _written++;
+            else
+                _failed++;
+        }
+        _doneCv.notify_all();
+    }   // end while
+}   // end run
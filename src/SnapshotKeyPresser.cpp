@@ -23,6 +23,7 @@ using std::cout;
 using std::cerr;
 using std::endl;
 #include <fstream>
+#include <iomanip>
 
 
 // private
@@ -65,11 +66,81 @@ void SnapshotKeyPresser::saveSnapshot()
     const cv::Mat_<cv::Vec3b> img = getViewer()->extractImage();
     std::ostringstream oss;
     oss << "snapshot_" << (_snapCount++) << ".jpg";
-    cv::imwrite( oss.str(), img);
-    cout << "Snapshot saved to " << oss.str() << endl;
+    if ( _encoder->write( img, oss.str()))
+        cout << "Snapshot saving to " << oss.str() << endl;
+    else
+        cerr << "Snapshot dropped (encoder queue full)" << endl;
 }   // end saveSnapshot
 
 
+// private
+void SnapshotKeyPresser::onRender( vtkObject*, unsigned long, void* clientData, void*)
+{
+    static_cast<SnapshotKeyPresser*>(clientData)->recordFrame();
+}   // end onRender
+
+
+// private
+void SnapshotKeyPresser::recordFrame()
+{
+    if ( !_recording)
+        return;
+    cv::Mat_<cv::Vec3b> img;    // New buffer each frame since the encoder holds on to it
+    _capture.readColour( img);
+    if ( !_videoFile.empty())
+        _encoder->writeFrame( img);
+    else
+    {
+        std::ostringstream oss;
+        oss << "frame_" << std::setw(6) << std::setfill('0') << _frameCount << ".jpg";
+        _encoder->write( img, oss.str());
+    }   // end else
+    _frameCount++;
+}   // end recordFrame
+
+
+// public
+void SnapshotKeyPresser::setRecordVideo( const std::string& fname, double fps)
+{
+    _videoFile = fname;
+    _videoFps = fps;
+}   // end setRecordVideo
+
+
+// public
+void SnapshotKeyPresser::setRecording( bool enable)
+{
+    if ( enable == _recording)
+        return;
+
+    vtkRenderWindow* rw = getViewer()->renderWindow();
+    if ( enable)
+    {
+        _frameCount = 0;
+        _encoder->resetStats();
+        if ( !_videoFile.empty() && !_encoder->openVideo( _videoFile, _videoFps, getViewer()->size()))
+            return;
+        // Frames are read after the buffers are swapped so read the front buffer if on screen.
+        _capture.setReadFrontBuffer( !rw->GetOffScreenRendering());
+        _observerTag = rw->AddObserver( vtkCommand::EndEvent, _renderCallback);
+        _recording = true;
+        cout << "Recording started" << endl;
+    }   // end if
+    else
+    {
+        rw->RemoveObserver( _observerTag);
+        _recording = false;
+        if ( !_videoFile.empty())
+            _encoder->closeVideo();
+        else
+            _encoder->flush();
+        cout << "Recording stopped: " << _frameCount << " frames captured, "
+             << _encoder->written() << " written, " << _encoder->dropped() << " dropped, "
+             << _encoder->failed() << " failed (max queue depth " << _encoder->maxQueued() << ")" << endl;
+    }   // end else
+}   // end setRecording
+
+
 
 RVTK::SnapshotKeyPresser::Ptr SnapshotKeyPresser::create( RVTK::Viewer::Ptr p,
         const cv::Vec3d& camPos, const cv::Vec3d& focalDir, const cv::Vec3d& upVec, float fov)
@@ -118,6 +189,11 @@ bool SnapshotKeyPresser::handleKeyPress( const string& keySym)
         handled = true;
         saveSnapshot();
     }   // end else if
+    else if ( keySym == "R")    // Toggle recording of every rendered frame
+    {
+        handled = true;
+        setRecording( !_recording);
+    }   // end else if
     else if ( keySym == "D")
     {
         handled = true;
@@ -186,19 +262,31 @@ void SnapshotKeyPresser::printUsage( std::ostream& os) const
     os << "Roll camera with '<' and '>'" << endl;
     os << "Display set image: 'D'" << endl;
     os << "Save JPEG Snapshot: 'S'" << endl;
+    os << "Start/stop recording: 'R'" << endl;
 }   // end printUsage
 
 
 
 SnapshotKeyPresser::SnapshotKeyPresser( RVTK::Viewer::Ptr v,
         const cv::Vec3d& camPos, const cv::Vec3d& focDir, const cv::Vec3d& vUp, float fov)
-    : RVTK::KeyPresser(v), _camPos(camPos), _focalDir(focDir / cv::norm(focDir)), _viewUp(vUp), _fov(fov), _snapCount(0)
+    : RVTK::KeyPresser(v), _camPos(camPos), _focalDir(focDir / cv::norm(focDir)), _viewUp(vUp), _fov(fov), _snapCount(0),
+      _encoder( new SnapshotEncoder), _capture( *v), _observerTag(0), _recording(false),
+      _frameCount(0), _videoFps(25)
 {
     _showingImage = false;
+    _renderCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    _renderCallback->SetCallback( &SnapshotKeyPresser::onRender);
+    _renderCallback->SetClientData( this);
     resetCamera();
 }   // end ctor
 
 
+SnapshotKeyPresser::~SnapshotKeyPresser()
+{
+    setRecording( false);
+}   // end dtor
+
+
 
 void SnapshotKeyPresser::setImage( const cv::Mat& img)
 {
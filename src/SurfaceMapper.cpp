@@ -17,163 +17,308 @@
 
 #include <SurfaceMapper.h>
 #include <VtkTools.h>
+#include <VtkActorCreator.h>
+#include <ParallelChunks.h>
 using RVTK::SurfaceMapper;
 using RVTK::MetricFn;
 #include <vtkSmartPointer.h>
 #include <vtkFloatArray.h>
+#include <vtkIntArray.h>
 #include <vtkPointData.h>
 #include <vtkCellData.h>
 #include <climits>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
 #include <cassert>
 using RFeatures::ObjModel;
 
 
-SurfaceMapper::CPtr SurfaceMapper::create( const std::string& label, const MetricFn& fn, bool mapPolys, size_t d)
+SurfaceMapper::CPtr SurfaceMapper::create( const std::string& label, const BatchMetricFn& fn, bool mapPolys, size_t d)
 {
     return CPtr( new SurfaceMapper( label, fn, mapPolys, d), [](SurfaceMapper* x){ delete x;});
 }   // end create
 
 
-SurfaceMapper::SurfaceMapper( const std::string& label, const MetricFn& fn, bool mapPolys, size_t d)
+SurfaceMapper::CPtr SurfaceMapper::create( const std::string& label, const MetricFn& fn, bool mapPolys, size_t d)
+{
+    const BatchMetricFn bfn = [fn, d]( int id, int n, float* out)
+    {
+        for ( int i = 0; i < n; ++i)
+            for ( size_t k = 0; k < d; ++k)
+                *out++ = fn( id+i, k);
+    };  // end bfn
+    return create( label, bfn, mapPolys, d);
+}   // end create
+
+
+SurfaceMapper::SurfaceMapper( const std::string& label, const BatchMetricFn& fn, bool mapPolys, size_t d)
     : _label(label), _metricfn(fn), _mapsPolys(mapPolys), _ndims(d) {}
 
 
-// private
-float SurfaceMapper::val( int id, size_t k) const
+namespace {
+// Returns the point to model vertex mapping if the actor was generated with shared texture vertices.
+vtkIntArray* pointVertexIds( vtkActor* actor)
+{
+    vtkPointData* pdata = RVTK::getPolyData(actor)->GetPointData();
+    return vtkIntArray::SafeDownCast( pdata->GetArray( RVTK::VtkActorCreator::VERTEX_IDS_ARRAY.c_str()));
+}   // end pointVertexIds
+
+// Find if vertex metrics mapped to the actor's points need copying to duplicated points. On return,
+// pvids is set if the actor has an explicit mapping of points to vertices, or else hasDups is set
+// true if the actor has three points per triangle (in face order).
+void findPointLayout( vtkActor* actor, int nf, const int*& pvids, bool& hasDups)
 {
-    const float v = _metricfn(id,k);
-    _min[k] = std::min(v,_min[k]);
-    _max[k] = std::max(v,_max[k]);
-    return v;
-}   // end val
+    pvids = nullptr;
+    hasDups = false;
+    vtkIntArray* pvarr = pointVertexIds( actor);
+    if ( pvarr)
+        pvids = pvarr->GetPointer(0);
+    else
+        hasDups = RVTK::getPolyData(actor)->GetPoints()->GetNumberOfPoints() == 3*nf;
+}   // end findPointLayout
+
+// Set mn/mx to the range of component k over the ntuples tuples of nd components in vals.
+void scanRange( const float* vals, size_t ntuples, size_t nd, size_t k, float& mn, float& mx)
+{
+    mn = FLT_MAX;
+    mx = -FLT_MAX;
+    for ( size_t t = 0; t < ntuples; ++t)
+    {
+        mn = std::min( mn, vals[t*nd+k]);
+        mx = std::max( mx, vals[t*nd+k]);
+    }   // end for
+}   // end scanRange
+
+const size_t MIN_CHUNK = 4096;
+}   // end namespace
 
 
 // public
-void SurfaceMapper::mapMetrics( const ObjModel& model, vtkActor *actor) const
+void SurfaceMapper::mapMetrics( const ObjModel& model, vtkActor *actor, size_t nthreads) const
 {
     assert( model.hasSequentialIds());
     const size_t nd = ndimensions();
     assert( nd >= 1);
 
-    // Reset the min/max values for this call to mapMetrics.
-    _min.resize(nd);
-    _max.resize(nd);
-    for ( size_t i = 0; i < nd; ++i)
-    {
-        _min[i] = FLT_MAX;
-        _max[i] = -FLT_MAX;
-    }   // end for
+    const int nf = model.numPolys();
+    const int nv = model.numVtxs();
+    vtkPolyData* pd = RVTK::getPolyData(actor);
+
+    // For vertex mapping, depending on how the actor's polydata have been created, there could be the
+    // same number of points as there are vertices in the model (if texture mapping was not done),
+    // three times the number of triangles (if texture mapping was done), or some number in between
+    // with an explicit mapping of points to vertices (if texture mapping was done with shared vertices).
+    // In the first case, setting the value is a straight forward one-to-one mapping. Otherwise, the
+    // metric for each vertex is calculated once and then copied to all of its corresponding points.
+    const int np = static_cast<int>(pd->GetPoints()->GetNumberOfPoints());
+    const int* pvids = nullptr;
+    bool hasDups = false;
+    if ( !_mapsPolys)
+        findPointLayout( actor, nf, pvids, hasDups);
+
+    const size_t nids = size_t(_mapsPolys ? nf : nv);   // Number of IDs to evaluate metrics for
+    const size_t ntuples = (pvids || hasDups) ? size_t(np) : nids;
 
     vtkSmartPointer<vtkFloatArray> cvals = vtkSmartPointer<vtkFloatArray>::New();
     cvals->SetName( _label.c_str());
+    cvals->SetNumberOfComponents( static_cast<int>(nd));
+    cvals->SetNumberOfTuples( static_cast<vtkIdType>(ntuples));
+    float* out = cvals->GetPointer(0);
 
-    const int nf = model.numPolys();
-    const int nv = model.numVtxs();
-
-    if ( nd == 1)  // Scalars
+    // Evaluate straight into the output array unless values need copying to duplicate points.
+    std::vector<float> dense;
+    float* vals = out;
+    if ( pvids || hasDups)
     {
-        if ( _mapsPolys)
-        {
-            cvals->SetNumberOfValues( nf);
-            for ( int fid = 0; fid < nf; ++fid)
-                cvals->SetValue( fid, val( fid, 0));
-        }   // end if
-        else
-        {
-            // For vertex mapping, depending on how the actor's polydata have been created, there could be the
-            // same number of points as there are vertices in the model (if texture mapping was not done) or
-            // there could be three times the number of triangles (if texture mapping was done). In the first
-            // case, setting the value is a straight forward one-to-one mapping. However, in the second case,
-            // vertices that share faces will be duplicated and so each unique vertex metric value needs to
-            // be mapped to all of these duplicate corresponding points in the array.
-            const int np = RVTK::getPolyData(actor)->GetPoints()->GetNumberOfPoints();
-            const bool hasDups = np == 3*nf;
-            /*
-            std::cerr << "numVtxs  = " << nv << std::endl;
-            std::cerr << "numPolys = " << nf << std::endl;
-            std::cerr << "3*NF     = " << 3*nf << std::endl;
-            */
-
-            if ( !hasDups)
-            {
-                cvals->SetNumberOfValues( nv);
-                for ( int vid = 0; vid < nv; ++vid)
-                    cvals->SetValue( vid, val( vid, 0));    // One-to-one mapping
-            }   // end if
-            else
-            {
-                // Map of vertex ids to their values for local caching since we don't want
-                // to ask the client to repeatedly calculate the same metric for a vertex.
-                std::unordered_map<int,float> vmap;
-                int i = 0;
-                cvals->SetNumberOfValues( 3*nf);
-                for ( int fid = 0; fid < nf; ++fid)
-                {
-                    const int* fvidxs = model.fvidxs(fid);
-                    for ( int j = 0; j < 3; ++j)
-                    {
-                        const int vid = fvidxs[j];
-                        if ( vmap.count(vid) == 0)
-                            vmap[vid] = val( vid, 0);
-                        cvals->SetValue( i++, vmap[vid]);
-                    }   // end for
-                }   // end for
-            }   // end else
-        }   // end else
+        dense.resize( nids*nd);
+        vals = dense.data();
     }   // end if
-    else    // Vectors
+
+    // Evaluate in parallel chunks with each chunk keeping its own min/max.
+    const size_t nchunks = numChunks( nids, nthreads, MIN_CHUNK);
+    std::vector<float> cmin( nchunks*nd, FLT_MAX);
+    std::vector<float> cmax( nchunks*nd, -FLT_MAX);
+    parallelChunks( nids, [&]( size_t c, size_t b, size_t e)
     {
-        std::vector<float> mval(nd);
-        cvals->SetNumberOfComponents( static_cast<int>(nd));
-        
-        if ( _mapsPolys)
+        float* cvs = &vals[b*nd];
+        _metricfn( static_cast<int>(b), static_cast<int>(e-b), cvs);
+        float* mn = &cmin[c*nd];
+        float* mx = &cmax[c*nd];
+        const size_t n = (e-b)*nd;
+        for ( size_t i = 0; i < n; i += nd)
         {
-            cvals->SetNumberOfTuples( nf);
-            for ( int fid = 0; fid < nf; ++fid)
+            for ( size_t k = 0; k < nd; ++k)
             {
-                for ( size_t k = 0; k < nd; ++k)
-                    mval[k] = val( fid, k);
-                cvals->SetTuple( fid, &mval[0]);
+                mn[k] = std::min( mn[k], cvs[i+k]);
+                mx[k] = std::max( mx[k], cvs[i+k]);
             }   // end for
-        }   // end if
-        else
+        }   // end for
+    }, nthreads, MIN_CHUNK);
+
+    _min.assign( nd, FLT_MAX);
+    _max.assign( nd, -FLT_MAX);
+    for ( size_t c = 0; c < nchunks; ++c)
+    {
+        for ( size_t k = 0; k < nd; ++k)
         {
-            const bool hasDups = RVTK::getPolyData(actor)->GetPoints()->GetNumberOfPoints() == 3*nf;
+            _min[k] = std::min( _min[k], cmin[c*nd+k]);
+            _max[k] = std::max( _max[k], cmax[c*nd+k]);
+        }   // end for
+    }   // end for
 
-            if ( !hasDups)
-            {
-                cvals->SetNumberOfTuples( nv);
-                for ( int vid = 0; vid < nv; ++vid)
-                {
-                    for ( size_t k = 0; k < nd; ++k)
-                        mval[k] = val( vid, k);
-                    cvals->SetTuple( vid, &mval[0]);
-                }   // end for
-            }   // end if
-            else
+    // Scatter the per vertex values to their duplicated points.
+    const size_t tsz = nd*sizeof(float);
+    if ( pvids)
+    {
+        parallelChunks( ntuples, [&]( size_t, size_t b, size_t e)
+        {
+            for ( size_t i = b; i < e; ++i)
+                std::memcpy( &out[i*nd], &vals[size_t(pvids[i])*nd], tsz);
+        }, nthreads, MIN_CHUNK);
+    }   // end if
+    else if ( hasDups)
+    {
+        parallelChunks( size_t(nf), [&]( size_t, size_t b, size_t e)
+        {
+            for ( size_t fid = b; fid < e; ++fid)
             {
-                std::unordered_map<int, std::vector<float> > vmap;
-                int i = 0;
-                cvals->SetNumberOfTuples( 3*nf);
-                for ( int fid = 0; fid < nf; ++fid)
-                {
-                    const int* fvidxs = model.fvidxs(fid);
-                    for ( int j = 0; j < 3; ++j)
-                    {
-                        const int vid = fvidxs[j];
-                        if ( vmap.count(vid) == 0)
-                        {
-                            for ( size_t k = 0; k < nd; ++k)
-                                vmap[vid][k] = val( vid, k);
-                        }   // end if
-                        cvals->SetTuple( i++, &vmap[vid][0]);
-                    }   // end for
-                }   // end for
-            }   // end else
-        }   // end else
-    }   // end else
+                const int* fvidxs = model.fvidxs( static_cast<int>(fid));
+                for ( size_t j = 0; j < 3; ++j)
+                    std::memcpy( &out[(3*fid+j)*nd], &vals[size_t(fvidxs[j])*nd], tsz);
+            }   // end for
+        }, nthreads, MIN_CHUNK);
+    }   // end else if
 
-    vtkPolyData* pd = RVTK::getPolyData(actor);
     vtkDataSetAttributes *ds = _mapsPolys ? (vtkDataSetAttributes*)pd->GetCellData() : (vtkDataSetAttributes*)pd->GetPointData();
     ds->AddArray( cvals);
+    _rangeArray = cvals.GetPointer();
+    _rangeMTime = cvals->GetMTime();
 }   // end mapMetrics
+
+
+// private
+const SurfaceMapper::PointIndex& SurfaceMapper::pointIndex( vtkActor* actor, const ObjModel& model, const int* pvids) const
+{
+    vtkPolyData* pd = RVTK::getPolyData(actor);
+    vtkIntArray* pvarr = pointVertexIds( actor);
+    const vtkMTimeType mtime = std::max( pd->GetPoints()->GetMTime(), pvarr ? pvarr->GetMTime() : vtkMTimeType(0));
+    const size_t np = static_cast<size_t>(pd->GetPoints()->GetNumberOfPoints());
+    PointIndex& pidx = _pointIndex;
+    if ( pidx.pd == pd && pidx.mtime == mtime && pidx.pids.size() == np)
+        return pidx;
+
+    // Point i was made from vertex pvids[i], or else from vertex j of face i/3 (three points per face).
+    const int nv = model.numVtxs();
+    const auto vidOf = [&]( size_t i){ return pvids ? pvids[i] : model.fvidxs( int(i/3))[i%3];};
+    pidx.offs.assign( size_t(nv)+1, 0);
+    for ( size_t i = 0; i < np; ++i)
+        pidx.offs[vidOf(i)+1]++;
+    for ( int v = 0; v < nv; ++v)
+        pidx.offs[v+1] += pidx.offs[v];
+    pidx.pids.resize( np);
+    std::vector<int> pos( pidx.offs.begin(), pidx.offs.end()-1);
+    for ( size_t i = 0; i < np; ++i)
+        pidx.pids[pos[vidOf(i)]++] = static_cast<int>(i);
+
+    pidx.pd = pd;
+    pidx.mtime = mtime;
+    return pidx;
+}   // end pointIndex
+
+
+// public
+size_t SurfaceMapper::updateMetrics( const ObjModel& model, vtkActor* actor, const IntSet& ids) const
+{
+    const size_t nd = ndimensions();
+    vtkPolyData* pd = RVTK::getPolyData(actor);
+    vtkDataSetAttributes *ds = _mapsPolys ? (vtkDataSetAttributes*)pd->GetCellData() : (vtkDataSetAttributes*)pd->GetPointData();
+    vtkFloatArray* cvals = vtkFloatArray::SafeDownCast( ds->GetArray( _label.c_str()));
+    if ( !cvals || cvals->GetNumberOfComponents() != static_cast<int>(nd) || ids.empty())
+        return 0;
+
+    float* out = cvals->GetPointer(0);
+    const size_t ntuples = static_cast<size_t>(cvals->GetNumberOfTuples());
+
+    // The incremental min/max is only valid for the array it was last found for. If this is
+    // a different actor's array (or the array was changed elsewhere), rescan it first.
+    if ( _rangeArray.GetPointer() != cvals || _rangeMTime != cvals->GetMTime() || _min.size() != nd)
+    {
+        _min.resize( nd);
+        _max.resize( nd);
+        for ( size_t k = 0; k < nd; ++k)
+            scanRange( out, ntuples, nd, k, _min[k], _max[k]);
+    }   // end if
+
+    // Evaluate the new values calling the metric function over runs of consecutive IDs.
+    std::vector<int> vids( ids.begin(), ids.end());
+    std::sort( vids.begin(), vids.end());
+    const size_t n = vids.size();
+    std::vector<float> vals( n*nd);
+    for ( size_t i = 0; i < n;)
+    {
+        size_t j = i+1;
+        while ( j < n && vids[j] == vids[j-1] + 1)
+            j++;
+        _metricfn( vids[i], static_cast<int>(j-i), &vals[i*nd]);
+        i = j;
+    }   // end for
+
+    std::vector<bool> rescan( nd, false);
+    size_t nwritten = 0;
+
+    // Write the values for source index s to tuple t noting if extreme values are moved inwards.
+    const auto write = [&]( size_t t, size_t s)
+    {
+        float* dst = &out[t*nd];
+        const float* src = &vals[s*nd];
+        for ( size_t k = 0; k < nd; ++k)
+        {
+            const float ov = dst[k];
+            const float nv = src[k];
+            if ( (ov <= _min[k] && nv > ov) || (ov >= _max[k] && nv < ov))
+                rescan[k] = true;
+            _min[k] = std::min( _min[k], nv);
+            _max[k] = std::max( _max[k], nv);
+            dst[k] = nv;
+        }   // end for
+        nwritten++;
+    };  // end write
+
+    const int nf = model.numPolys();
+    const int* pvids = nullptr;
+    bool hasDups = false;
+    if ( !_mapsPolys)
+        findPointLayout( actor, nf, pvids, hasDups);
+
+    if ( !pvids && !hasDups)    // One-to-one mapping
+    {
+        for ( size_t s = 0; s < n; ++s)
+            if ( vids[s] >= 0 && size_t(vids[s]) < ntuples)
+                write( size_t(vids[s]), s);
+    }   // end if
+    else
+    {
+        // Only touch the points duplicated from the updated vertices.
+        const PointIndex& pidx = pointIndex( actor, model, pvids);
+        for ( size_t s = 0; s < n; ++s)
+        {
+            const int vid = vids[s];
+            if ( vid < 0 || size_t(vid) + 1 >= pidx.offs.size())
+                continue;
+            for ( int j = pidx.offs[vid]; j < pidx.offs[vid+1]; ++j)
+                write( size_t(pidx.pids[j]), s);
+        }   // end for
+    }   // end else
+
+    // Recalculate the min/max for components where a previous extreme value may have been lost.
+    for ( size_t k = 0; k < nd; ++k)
+        if ( rescan[k])
+            scanRange( out, ntuples, nd, k, _min[k], _max[k]);
+
+    if ( nwritten > 0)
+        cvals->Modified();
+    _rangeArray = cvals;
+    _rangeMTime = cvals->GetMTime();
+    return nwritten;
+}   // end updateMetrics
@@ -17,12 +17,13 @@
 
 #include <Viewer.h>
 #include <VtkTools.h>
+#include <FrameCapture.h>
 #include <vtkFollower.h>
 using RVTK::Viewer;
 
 Viewer::Ptr Viewer::create( bool offscreen) { return Ptr( new Viewer( offscreen), [](Viewer* d){delete d;});}
 
-Viewer::Viewer( bool offscreen)
+Viewer::Viewer( bool offscreen) : _startTag(0), _endTag(0)
 {
     _renWin->SetOffScreenRendering(offscreen);
 	_ren->SetBackground( 0.0, 0.0, 0.0);
@@ -33,6 +34,12 @@ Viewer::Viewer( bool offscreen)
 }  // end ctor
 
 
+Viewer::~Viewer()
+{
+    setStatsEnabled( false);    // Window may outlive this viewer if referenced elsewhere
+}   // end dtor
+
+
 void Viewer::addActor( vtkActor* actor)
 {
     _ren->AddViewProp( actor);
@@ -153,5 +160,91 @@ cv::Size Viewer::size() const
 }   // end size
 
 void Viewer::updateRender() { _renWin->Render();}
-cv::Mat_<cv::Vec3b> Viewer::extractImage() const { return RVTK::extractImage( _renWin);}
-cv::Mat_<float> Viewer::extractZBuffer() const { return RVTK::extractZBuffer( _renWin);}
+
+
+cv::Mat_<cv::Vec3b> Viewer::extractImage() const
+{
+    if ( !_stats)
+        return RVTK::extractImage( _renWin);
+    _renWin->Render();
+    const double t0 = _stats->now();
+    cv::Mat_<cv::Vec3b> img;
+    FrameCapture( _renWin).readColour( img);
+    _stats->addReadback( _stats->now() - t0);
+    return img;
+}   // end extractImage
+
+
+cv::Mat_<float> Viewer::extractZBuffer() const
+{
+    if ( !_stats)
+        return RVTK::extractZBuffer( _renWin);
+    _renWin->Render();
+    const double t0 = _stats->now();
+    cv::Mat_<float> zbuff;
+    FrameCapture( _renWin).readDepth( zbuff);
+    _stats->addReadback( _stats->now() - t0);
+    return zbuff;
+}   // end extractZBuffer
+
+
+void Viewer::setStatsEnabled( bool enable, size_t window)
+{
+    if ( !enable)
+    {
+        if ( _stats)
+        {
+            _renWin->RemoveObserver( _startTag);
+            _renWin->RemoveObserver( _endTag);
+            _stats.reset();
+        }   // end if
+        return;
+    }   // end if
+
+    if ( _stats)
+    {
+        _stats->setWindow( window);
+        return;
+    }   // end if
+
+    _stats.reset( new RenderStats( window));
+    if ( !_statsCallback)
+    {
+        _statsCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+        _statsCallback->SetCallback( &Viewer::onRenderEvent);
+        _statsCallback->SetClientData( this);
+    }   // end if
+    _startTag = _renWin->AddObserver( vtkCommand::StartEvent, _statsCallback);
+    _endTag = _renWin->AddObserver( vtkCommand::EndEvent, _statsCallback);
+}   // end setStatsEnabled
+
+
+// private static
+void Viewer::onRenderEvent( vtkObject*, unsigned long eid, void* clientData, void*)
+{
+    Viewer* v = static_cast<Viewer*>(clientData);
+    if ( !v->_stats)
+        return;
+    if ( eid == vtkCommand::StartEvent)
+        v->_stats->beginFrame();
+    else
+        v->_stats->endFrame( v->_ren);
+}   // end onRenderEvent
+
+
+cv::Mat_<float> Viewer::extractLinearDepth() const
+{
+    cv::Mat_<float> edepth;
+    RVTK::unprojectZBuffer( _ren->GetActiveCamera(), _ren->GetTiledAspectRatio(), extractZBuffer(),
+                            &edepth, nullptr, 0, cv::Vec4d( _ren->GetViewport()));
+    return edepth;
+}   // end extractLinearDepth
+
+
+cv::Mat_<cv::Vec3f> Viewer::extractPointMap( cv::Mat_<float>* edepth) const
+{
+    cv::Mat_<cv::Vec3f> points;
+    RVTK::unprojectZBuffer( _ren->GetActiveCamera(), _ren->GetTiledAspectRatio(), extractZBuffer(),
+                            edepth, &points, 0, cv::Vec4d( _ren->GetViewport()));
+    return points;
+}   // end extractPointMap
@@ -16,6 +16,7 @@
  ************************************************************************/
 
 #include "ViewerProjector.h"
+#include "VtkTools.h"
 using RVTK::ViewerProjector;
 #include <algorithm>
 #include <iostream>
@@ -34,14 +35,8 @@ cv::Mat_<cv::Vec3b> ViewerProjector::extractImage() const
 
 cv::Mat ViewerProjector::makeRangeMap( float depthProp, int colourMap) const
 {
-    cv::Mat_<float> rngMap = _viewer->extractZBuffer();
-
-    double mn, mx;
-    cv::minMaxLoc( rngMap, &mn, &mx);
-    rngMap -= float(mn);   // Make nearest point 0
-    
-    cv::Mat img;
-    rngMap.convertTo( img, CV_8U, -255./((mx-mn)*depthProp), 255);
+    cv::Mat_<unsigned char> img;
+    RVTK::makeDepthByteMap( _viewer->extractZBuffer(), img, depthProp);
 
     if ( colourMap < 0)
         return img;
@@ -18,11 +18,16 @@
 #include <VtkActorCreator.h>
 #include <VtkTools.h>
 #include <cassert>
+#include <cstring>
+#include <functional>
+#include <map>
 #include <vtkPoints.h>
 #include <vtkTexture.h>
 #include <vtkProperty.h>
 #include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkFloatArray.h>
+#include <vtkIntArray.h>
 #include <vtkPointData.h>
 using RFeatures::ObjModel;
 using RVTK::VtkActorCreator;
@@ -32,14 +37,15 @@ namespace {
 
 void init()
 {
-    static bool initCalled = false;
-    if (!initCalled)
+    // Function local static initialisation is thread safe (actors may be created on render pool threads).
+    static const bool initCalled = []()
     {
         // Add static initialisation here...
         vtkMapper::SetResolveCoincidentTopologyToPolygonOffset();
-        initCalled = true;
-    }   // end if
-}   // end ctor
+        return true;
+    }();
+    (void)initCalled;
+}   // end init
 
 
 vtkSmartPointer<vtkActor> makeActor( vtkSmartPointer<vtkPolyData> pd)
@@ -306,50 +312,116 @@ vtkSmartPointer<vtkActor> VtkActorCreator::generateLinePairsActor( const std::ve
 
 
 namespace {
+// Fill the point coordinates directly into the float array backing the returned vtkPoints
+// rather than calling SetPoint (virtual + double conversion) for every vertex.
 vtkSmartPointer<vtkPoints> createSequencePoints( const ObjModel& model)
 {
     assert( model.hasSequentialVertexIds());
     const int n = model.numVtxs();
+    vtkSmartPointer<vtkFloatArray> coords = vtkSmartPointer<vtkFloatArray>::New();
+    coords->SetNumberOfComponents(3);
+    float* cptr = coords->WritePointer( 0, 3*vtkIdType(n));
+    for ( int i = 0; i < n; ++i, cptr += 3)
+        std::memcpy( cptr, &model.uvtx( i)[0], 3*sizeof(float));
+
     vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-    points->SetNumberOfPoints( n);
-    for ( int i = 0; i < n; ++i)
-        points->SetPoint( i, &model.uvtx( i)[0]);
+    points->SetData( coords);
     return points;
 }   // end createSequencePoints
 
 
+// Write the legacy cell layout (npts, id0, id1, id2) for all triangles in one pass into a single
+// preallocated vtkIdTypeArray and hand it to the cell array wholesale instead of doing four
+// InsertNext* calls (with their incremental reallocations) per triangle.
 vtkSmartPointer<vtkCellArray> createSequencePolys( const ObjModel& model)
 {
     assert( model.hasSequentialFaceIds());
     const int n = model.numPolys();
-    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
-    for ( int f = 0; f < n; ++f)
+    vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+    vtkIdType* cptr = cells->WritePointer( 0, 4*vtkIdType(n));
+    for ( int f = 0; f < n; ++f, cptr += 4)
     {
         const int* fvidxs = model.fvidxs(f);
-        polys->InsertNextCell( 3);
-        polys->InsertCellPoint( fvidxs[0]);
-        polys->InsertCellPoint( fvidxs[1]);
-        polys->InsertCellPoint( fvidxs[2]);
+        cptr[0] = 3;
+        cptr[1] = fvidxs[0];
+        cptr[2] = fvidxs[1];
+        cptr[3] = fvidxs[2];
     }   // end for
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetCells( n, cells);
     return polys;
 }   // end createSequencePolys
 
 
-vtkSmartPointer<vtkPolyData> createSequencePolyData( const ObjModel& model)
+vtkSmartPointer<vtkFloatArray> toNormalsArray( const std::vector<cv::Vec3f>& vnrms, const char* name)
+{
+    vtkSmartPointer<vtkFloatArray> nrm = vtkSmartPointer<vtkFloatArray>::New();
+    nrm->SetName( name);
+    nrm->SetNumberOfComponents(3);
+    std::memcpy( nrm->WritePointer( 0, 3*vtkIdType(vnrms.size())), vnrms.data(), vnrms.size()*sizeof(cv::Vec3f));
+    return nrm;
+}   // end toNormalsArray
+
+
+// Per model vertex normals. By default these come from vtkPolyDataNormals (with its consistency
+// reordering and feature edge splitting) so shading is unchanged; where points are split, the normals
+// of the points keeping the model's vertex IDs are used. If fastNormals is true, the native parallel
+// kernel RVTK::calcVertexNormals is used instead.
+void calcModelNormals( const ObjModel& model, bool fastNormals, std::vector<cv::Vec3f>& vnrms)
+{
+    if ( fastNormals)
+    {
+        RVTK::calcVertexNormals( model, vnrms);
+        return;
+    }   // end if
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints( createSequencePoints( model));
+    pd->SetPolys( createSequencePolys( model));
+    vtkDataArray* vn = RVTK::generateNormals( pd)->GetPointData()->GetNormals();
+    const int n = model.numVtxs();
+    vnrms.resize( n);
+    double nv[3];
+    for ( int i = 0; i < n; ++i)
+    {
+        vn->GetTuple( i, nv);
+        vnrms[i] = cv::Vec3f( float(nv[0]), float(nv[1]), float(nv[2]));
+    }   // end for
+}   // end calcModelNormals
+
+
+// Returns false if the stage function (if given) returns false at proportion p of actor creation.
+bool stageReached( const VtkActorCreator::StageFn& stage, float p)
+{
+    return !stage || stage(p);
+}   // end stageReached
+
+
+vtkSmartPointer<vtkPolyData> createSequencePolyData( const ObjModel& model, bool fastNormals, const VtkActorCreator::StageFn& stage)
 {
     vtkSmartPointer<vtkPoints> points = createSequencePoints( model);
     vtkSmartPointer<vtkCellArray> faces = createSequencePolys( model);
     vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
     pd->SetPoints( points);
     pd->SetPolys( faces);
-    pd = RVTK::generateNormals( pd);    // Required for interpolated shading
+    if ( !stageReached( stage, 0.3f))
+        return nullptr;
+
+    // Required for interpolated shading
+    if ( !fastNormals)
+        return RVTK::generateNormals( pd);
+
+    std::vector<cv::Vec3f> vnrms;
+    RVTK::calcVertexNormals( model, vnrms);
+    pd->GetPointData()->SetNormals( toNormalsArray( vnrms, "Normals"));
     return pd;
 }   // end createSequencePolyData
 
 }   // end namespace
 
 
-vtkSmartPointer<vtkActor> VtkActorCreator::generateSurfaceActor( const ObjModel& model)
+vtkSmartPointer<vtkActor> VtkActorCreator::generateSurfaceActor( const ObjModel& model, bool fastNormals, const StageFn& stage)
 {
     assert( model.hasSequentialIds());
     if ( !model.hasSequentialIds())
@@ -359,14 +431,189 @@ vtkSmartPointer<vtkActor> VtkActorCreator::generateSurfaceActor( const ObjModel&
     }   // end if
 
     init();
-    vtkSmartPointer<vtkPolyData> pd = createSequencePolyData( model);
+    vtkSmartPointer<vtkPolyData> pd = createSequencePolyData( model, fastNormals, stage);
+    if ( !pd || !stageReached( stage, 0.9f))
+        return nullptr;
     vtkSmartPointer<vtkActor> actor = makeActor( pd);
     actor->PokeMatrix( RVTK::toVTK( model.transformMatrix()));
     return actor;
 }   // end generateSurfaceActor
 
 
-vtkSmartPointer<vtkActor> VtkActorCreator::generateActor( const ObjModel& model)
+namespace {
+
+vtkSmartPointer<vtkFloatArray> createFloatArray( const char* name, int ncomps, int ntuples)
+{
+    vtkSmartPointer<vtkFloatArray> arr = vtkSmartPointer<vtkFloatArray>::New();
+    arr->SetNumberOfComponents( ncomps);
+    arr->SetNumberOfTuples( ntuples);
+    if ( name)
+        arr->SetName( name);
+    return arr;
+}   // end createFloatArray
+
+
+using MaterialPolyData = std::map<int, vtkSmartPointer<vtkPolyData> >;
+
+// Create a polydata for each group of faces sharing the same material (as given by fmid) where all
+// of the returned polydata share the same points, texture coordinates and normals. By default, three
+// points are created per triangle because VTK only does per vertex texture mapping so needs more points
+// than model vertices to correspond with the texture vertices. If shareVertices is true, a model vertex
+// is only split into more than one point where the faces using it have different materials or map it
+// to different texture coordinates. Either way, any point is only used by faces of a single material
+// so the shared texture coordinates array is valid for every returned polydata.
+// Returns false (leaving mpds empty) if the stage function returns false.
+bool createTexturePolyData( const ObjModel& model, const std::function<int(int)>& fmid,
+                            bool shareVertices, bool fastNormals, MaterialPolyData& mpds,
+                            const VtkActorCreator::StageFn& stage=nullptr)
+{
+    const int nv = model.numVtxs();
+    const int nf = model.numPolys();
+
+    std::vector<int> fmids(nf);
+    std::map<int, int> mfcounts;   // Number of faces per material
+    for ( int fid = 0; fid < nf; ++fid)
+    {
+        fmids[fid] = fmid(fid);
+        mfcounts[fmids[fid]]++;
+    }   // end for
+
+    // Legacy (npts, id0, id1, id2) cell layouts per material filled in face order.
+    std::map<int, vtkSmartPointer<vtkIdTypeArray> > mcells;
+    std::map<int, vtkIdType*> mcptrs;
+    for ( const auto& mc : mfcounts)
+    {
+        vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+        mcptrs[mc.first] = cells->WritePointer( 0, 4*vtkIdType(mc.second));
+        mcells[mc.first] = cells;
+    }   // end for
+
+    std::vector<int> head( nv, -1); // Per model vertex, the last point created for it
+    std::vector<int> next;          // Per point, the previous point created for the same model vertex (or -1)
+    std::vector<int> pvids;         // Per point, the model vertex it was created from
+    std::vector<int> pmids;         // Per point, the material of the faces using it
+    std::vector<cv::Vec2f> puvs;    // Per point, its texture coordinates
+    const size_t rsv = shareVertices ? size_t(nv) : 3*size_t(nf);
+    next.reserve(rsv);
+    pvids.reserve(rsv);
+    pmids.reserve(rsv);
+    puvs.reserve(rsv);
+
+    for ( int fid = 0; fid < nf; ++fid)
+    {
+        const int mid = fmids[fid];
+        const int* fvidxs = model.fvidxs(fid);
+        const int* uvids = mid >= 0 ? model.faceUVs(fid) : nullptr;
+        vtkIdType*& cptr = mcptrs[mid];
+        cptr[0] = 3;
+        for ( int i = 0; i < 3; ++i)
+        {
+            const int vidx = fvidxs[i];
+            const cv::Vec2f uv = uvids ? model.uv( mid, uvids[i]) : cv::Vec2f(0,0);
+
+            // Look for an existing point for this vertex having the same material and texture coordinates.
+            int pid = shareVertices ? head[vidx] : -1;
+            while ( pid >= 0 && (pmids[pid] != mid || puvs[pid] != uv))
+                pid = next[pid];
+
+            if ( pid < 0)
+            {
+                pid = static_cast<int>(pvids.size());
+                next.push_back( head[vidx]);
+                head[vidx] = pid;
+                pvids.push_back( vidx);
+                pmids.push_back( mid);
+                puvs.push_back( uv);
+            }   // end if
+
+            cptr[i+1] = pid;
+        }   // end for
+        cptr += 4;
+    }   // end for
+    if ( !stageReached( stage, 0.3f))
+        return false;
+
+    // Normals are calculated over the model's own vertices so points split from the
+    // same vertex share the same normal and texture seams are not shaded. Shared vertex
+    // mode always uses the native kernel to avoid running a VTK normals pipeline per load.
+    std::vector<cv::Vec3f> vnrms;
+    calcModelNormals( model, fastNormals || shareVertices, vnrms);
+    if ( !stageReached( stage, 0.6f))
+        return false;
+
+    const int NP = static_cast<int>(pvids.size());
+    vtkSmartPointer<vtkFloatArray> coords = createFloatArray( nullptr, 3, NP);
+    vtkSmartPointer<vtkFloatArray> uvs = createFloatArray( "TCoords_0", 2, NP);
+    vtkSmartPointer<vtkFloatArray> nrm = createFloatArray( "Normals_0", 3, NP);
+    vtkSmartPointer<vtkIntArray> vids;
+    int* vptr = nullptr;
+    if ( shareVertices)
+    {
+        vids = vtkSmartPointer<vtkIntArray>::New();
+        vids->SetName( VtkActorCreator::VERTEX_IDS_ARRAY.c_str());
+        vids->SetNumberOfValues( NP);
+        vptr = vids->GetPointer(0);
+    }   // end if
+
+    float* xptr = coords->GetPointer(0);
+    float* uptr = uvs->GetPointer(0);
+    float* nptr = nrm->GetPointer(0);
+    for ( int pid = 0; pid < NP; ++pid)
+    {
+        const int vidx = pvids[pid];
+        std::memcpy( &xptr[3*pid], &model.uvtx( vidx)[0], 3*sizeof(float));
+        std::memcpy( &nptr[3*pid], &vnrms[vidx][0], 3*sizeof(float));
+        uptr[2*pid+0] = puvs[pid][0];
+        uptr[2*pid+1] = puvs[pid][1];
+        if ( vptr)
+            vptr[pid] = vidx;
+    }   // end for
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData( coords);
+
+    for ( const auto& mc : mcells)
+    {
+        vtkSmartPointer<vtkCellArray> faces = vtkSmartPointer<vtkCellArray>::New();
+        faces->SetCells( mfcounts.at(mc.first), mc.second);
+
+        vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+        pd->SetPoints( points);
+        pd->SetPolys( faces);
+        pd->GetPointData()->SetTCoords( uvs);
+        pd->GetPointData()->SetNormals( nrm);  // Required for interpolated shading
+        if ( vids)
+            pd->GetPointData()->AddArray( vids);
+        mpds[mc.first] = pd;
+    }   // end for
+    return true;
+}   // end createTexturePolyData
+
+
+// Texture may be null (for faces without a material) in which case the actor is lit the same as textured actors.
+vtkSmartPointer<vtkActor> makeTexturedActor( vtkSmartPointer<vtkPolyData> pd, vtkSmartPointer<vtkTexture> texture, const ObjModel& model)
+{
+    vtkSmartPointer<vtkActor> actor = makeActor(pd);
+    if ( texture)
+        actor->SetTexture( texture);
+
+    // Set ambient lighting for proper texture lighting
+    actor->GetProperty()->SetAmbient(1.0);
+    actor->GetProperty()->SetDiffuse(0.0);
+    actor->GetProperty()->SetSpecular(0.0);
+
+    actor->PokeMatrix( RVTK::toVTK( model.transformMatrix()));
+    return actor;
+}   // end makeTexturedActor
+
+}   // end namespace
+
+
+const std::string VtkActorCreator::VERTEX_IDS_ARRAY = "ObjVertexIds";
+
+
+vtkSmartPointer<vtkActor> VtkActorCreator::generateActor( const ObjModel& model, bool shareVertices, bool fastNormals,
+                                                          const StageFn& stage)
 {
     if ( model.numMats() > 1)  // Can't create if more than one material!
     {
@@ -383,85 +630,50 @@ vtkSmartPointer<vtkActor> VtkActorCreator::generateActor( const ObjModel& model)
     if ( model.numMats() == 0)
     {
         std::cerr << "[INFO] RVTK::VtkActorCreator::generateActor: Model has no materials; generating surface actor." << std::endl;
-        return generateSurfaceActor( model);
+        return generateSurfaceActor( model, fastNormals, stage);
     }   // end if
 
     init();
 
     const int MID = *model.materialIds().begin();   // The one and only material ID
+    MaterialPolyData mpds;
+    if ( !createTexturePolyData( model, [MID](int){ return MID;}, shareVertices, fastNormals, mpds, stage))
+        return nullptr;
     vtkSmartPointer<vtkTexture> texture = RVTK::convertToTexture( model.texture(MID));
+    if ( !stageReached( stage, 0.9f))
+        return nullptr;
+    return makeTexturedActor( mpds.at(MID), texture, model);
+}   // end generateActor
 
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-    vtkSmartPointer<vtkCellArray> faces = vtkSmartPointer<vtkCellArray>::New();
-
-    // Need THREE TIMES the number of triangles in points because VTK only does per vertex texture
-    // mapping so need more points than necessary to correspond with the texture vertices.
-    const int NP = 3*model.numPolys();
-    points->SetNumberOfPoints( NP);
-
-    // The array to hold the 2D texture coordinates.
-    vtkSmartPointer<vtkFloatArray> uvs = vtkSmartPointer<vtkFloatArray>::New();
-    uvs->SetNumberOfComponents(2);
-    uvs->SetNumberOfTuples( NP);
-    uvs->SetName( "TCoords_0");
-
-    // We need to map vertex normals to the texture mapped points. We can't use VTKs built in normal generator algorithm
-    // directly on the cell array being populated here because this expects it to be connected with common vertex IDs
-    // which it is not because VTK doesn't do per polygon texture mapping (which is really annoying). To hack around this,
-    // we create a second temporary poly data object as though we're just making a surface model, and map the point normals
-    // calculated on it to a float array which we use to manually set the normals.
-    vtkSmartPointer<vtkPolyData> tmpPolyData = createSequencePolyData( model);
-    vtkDataArray* cnrms = tmpPolyData->GetPointData()->GetNormals();
-    double nv[3];
-    vtkSmartPointer<vtkFloatArray> nrm = vtkSmartPointer<vtkFloatArray>::New();
-    nrm->SetNumberOfComponents(3);
-    nrm->SetNumberOfTuples( NP);
-    nrm->SetName( "Normals_0");
 
-    int vtkPointId = 0;
-    const int nfaces = model.numPolys();
-    for ( int fid = 0; fid < nfaces; ++fid)    // Over all polygons
+size_t VtkActorCreator::generateActors( const ObjModel& model, std::vector<vtkSmartPointer<vtkActor> >& actors,
+                                        bool shareVertices, bool fastNormals)
+{
+    if ( !model.hasSequentialIds())
     {
-        faces->InsertNextCell(3);
-        const int* fvidxs = model.fvidxs(fid);
-        const int* uvids = model.faceUVs(fid);
+        std::cerr << "[ERROR] RVTK::VtkActorCreator::generateActors: Model IDs must be in sequential order!" << std::endl;
+        return 0;
+    }   // end if
 
-        for ( int i = 0; i < 3; ++i)
-        {
-            const int vidx = fvidxs[i];
-            faces->InsertCellPoint( vtkPointId);
-            points->SetPoint( vtkPointId, &(model.uvtx( vidx)[0]));
+    if ( model.numMats() == 0)
+    {
+        actors.push_back( generateSurfaceActor( model, fastNormals));
+        return 1;
+    }   // end if
 
-            if ( uvids)
-            {
-                const cv::Vec2f& uv = model.uv( MID, uvids[i]);
-                uvs->SetTuple2( vtkPointId, uv[0], uv[1]);
-            }   // end if
-            else
-                uvs->SetTuple2( vtkPointId, 0.0, 0.0);
+    init();
 
-            cnrms->GetTuple( vidx, nv);
-            nrm->SetTuple3( vtkPointId, static_cast<float>(nv[0]), static_cast<float>(nv[1]), static_cast<float>(nv[2]));
+    MaterialPolyData mpds;
+    createTexturePolyData( model, [&model](int fid){ return model.faceMaterialId(fid);}, shareVertices, fastNormals, mpds);
 
-            vtkPointId++;
-        }   // end for
+    // Faces without a material are given their own untextured actor (lit as the textured actors are).
+    for ( const auto& mpd : mpds)
+    {
+        vtkSmartPointer<vtkTexture> texture;
+        if ( mpd.first >= 0)
+            texture = RVTK::convertToTexture( model.texture( mpd.first));
+        actors.push_back( makeTexturedActor( mpd.second, texture, model));
     }   // end for
 
-    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
-
-    pd->SetPoints( points);
-    pd->SetPolys( faces);
-    pd->GetPointData()->SetTCoords( uvs);
-    pd->GetPointData()->SetNormals( nrm);  // Required for interpolated shading
-
-    vtkSmartPointer<vtkActor> actor = makeActor(pd);
-    actor->SetTexture( texture);
-
-    // Set ambient lighting for proper texture lighting
-    actor->GetProperty()->SetAmbient(1.0);
-    actor->GetProperty()->SetDiffuse(0.0);
-    actor->GetProperty()->SetSpecular(0.0);
-
-    actor->PokeMatrix( RVTK::toVTK( model.transformMatrix()));
-    return actor;
-}   // end generateActor
+    return mpds.size();
+}   // end generateActors
@@ -16,19 +16,30 @@
  ************************************************************************/
 
 #include <VtkTools.h>
+#include <ParallelChunks.h>
+#include <FrameCapture.h>
 #include <vtkOctreePointLocator.h>
 #include <vtkFeatureEdges.h>
 #include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkPolyDataNormals.h>
-#include <vtkWindowToImageFilter.h>
-#include <vtkImageShiftScale.h>
-#include <vtkImageExport.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderer.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkMatrixToLinearTransform.h>
+#include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RVTK_SSE2
+#include <emmintrin.h>
+#endif
 
 
 void RVTK::setColoursLookupTable( vtkSmartPointer<vtkLookupTable> lut,
@@ -120,41 +131,64 @@ vtkSmartPointer<vtkImageImport> RVTK::makeImageImporter( const cv::Mat img)
 }   // end makeImageImporter
 
 
+namespace {
+
+// Rows per chunk when copying texture images; small images stay on the calling thread.
+const size_t MIN_TEXTURE_ROWS = 64;
+
+}   // end namespace
+
+
 // Converts the given image into a format suitable as a texture.
-// Flips the image vertically and transposes the first and second
-// bytes if image is triple channel.
+// The vertical flip and the BGR to RGB swap are done in a single pass directly
+// into the VTK owned scalar buffer of the texture's input image data so that
+// no intermediate images are made.
 vtkSmartPointer<vtkTexture> RVTK::convertToTexture( const cv::Mat& image, bool XFLIP)
 {
-    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
-
     // Only accepts either cv::Mat_<cv::Vec3b> or cv::Mat_<byte> images for now
     const int numChannels = image.channels();
-    if ( (image.depth() != CV_8U) || !image.isContinuous() || ( numChannels != 1 && numChannels != 3))
+    if ( (image.depth() != CV_8U) || image.empty() || ( numChannels != 1 && numChannels != 3))
     {
         std::cerr << "[WARNING] RVTK::convertToTexture(): Unable to create texture from image!" << std::endl;
         return vtkSmartPointer<vtkTexture>();
     }   // end if
 
-    // Flip the input image vertically.
-    cv::Mat img;
-    if ( XFLIP)
-        cv::flip( image, img, 0/*flip about x axis*/);
-    else
-        img = image;
+    const int rows = image.rows;
+    const int cols = image.cols;
+    const size_t rowBytes = size_t(cols) * size_t(numChannels);
+
+    vtkSmartPointer<vtkUnsignedCharArray> scalars = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    scalars->SetNumberOfComponents( numChannels);
+    scalars->SetNumberOfTuples( vtkIdType(rows) * cols);
+    unsigned char* buf = scalars->GetPointer(0);
 
-    if ( numChannels == 3)  // Swap byte order from BGR to RGB
+    // VTK rows are stored bottom up so row r of the buffer takes image row rows-1-r if flipping.
+    RVTK::parallelChunks( size_t(rows), [&]( size_t, size_t b, size_t e)
     {
-        std::vector<cv::Mat> channels;
-        cv::split( img, channels);
-        cv::Mat swappedChannels[3] = {channels[2], channels[1], channels[0]};
-        cv::Mat nimg;
-        cv::merge( swappedChannels, 3, nimg);
-        img = nimg;
-    }   // end if
+        for ( size_t r = b; r < e; ++r)
+        {
+            const int srow = XFLIP ? rows - 1 - int(r) : int(r);
+            const unsigned char* src = image.ptr<unsigned char>( srow);
+            unsigned char* dst = &buf[r * rowBytes];
+            if ( numChannels == 1)
+                std::memcpy( dst, src, rowBytes);
+            else
+            {
+                // Headers over the source row and the destination row in the scalars buffer
+                // so the (vectorised) BGR to RGB conversion writes straight into VTK's array.
+                const cv::Mat srcRow( 1, cols, CV_8UC3, const_cast<unsigned char*>( src));
+                cv::Mat dstRow( 1, cols, CV_8UC3, dst);
+                cv::cvtColor( srcRow, dstRow, cv::COLOR_BGR2RGB);
+            }   // end else
+        }   // end for
+    }, 0, MIN_TEXTURE_ROWS);
+
+    vtkSmartPointer<vtkImageData> img = vtkSmartPointer<vtkImageData>::New();
+    img->SetExtent( 0, cols-1, 0, rows-1, 0, 0);
+    img->GetPointData()->SetScalars( scalars);
 
-    // Make the texture from the image
-    vtkSmartPointer<vtkImageImport> imageImporter = RVTK::makeImageImporter( img);
-    texture->SetInputConnection( imageImporter->GetOutputPort());
+    vtkSmartPointer<vtkTexture> texture = vtkSmartPointer<vtkTexture>::New();
+    texture->SetInputData( img);
     texture->Update();
     return texture;
 }   // end convertToTexture
@@ -195,43 +229,160 @@ void RVTK::extractBoundaryVertices( const vtkSmartPointer<vtkPolyData>& pdata, s
 }   // end extractBoundaryVertices
 
 
-vtkSmartPointer<vtkPolyData> RVTK::generateNormals( vtkSmartPointer<vtkPolyData> pdata)
+vtkSmartPointer<vtkPolyData> RVTK::generateNormals( vtkSmartPointer<vtkPolyData> pdata, bool consistency, bool splitting)
 {
     vtkSmartPointer<vtkPolyDataNormals> normalsGenerator = vtkPolyDataNormals::New();
     normalsGenerator->SetInputData( pdata);
     normalsGenerator->ComputePointNormalsOn();
     normalsGenerator->ComputeCellNormalsOff();
     //normalsGenerator->NonManifoldTraversalOn();
-    //normalsGenerator->ConsistencyOff();
+    normalsGenerator->SetConsistency( consistency);
+    normalsGenerator->SetSplitting( splitting);
     normalsGenerator->Update();
     return normalsGenerator->GetOutput();
 }   // end generateNormals
 
 
+namespace {
+
+// Normals are accumulated over xyz0 padded vertices and face normals so each is one SSE register.
+#ifdef RVTK_SSE2
+// Cross product of the xyz lanes (the w lane is zero when both inputs have w zero).
+inline __m128 cross3( __m128 a, __m128 b)
+{
+    const __m128 ayzx = _mm_shuffle_ps( a, a, _MM_SHUFFLE(3,0,2,1));
+    const __m128 bzxy = _mm_shuffle_ps( b, b, _MM_SHUFFLE(3,1,0,2));
+    const __m128 azxy = _mm_shuffle_ps( a, a, _MM_SHUFFLE(3,1,0,2));
+    const __m128 byzx = _mm_shuffle_ps( b, b, _MM_SHUFFLE(3,0,2,1));
+    return _mm_sub_ps( _mm_mul_ps( ayzx, bzxy), _mm_mul_ps( azxy, byzx));
+}   // end cross3
+
+
+// Scale v (with w zero) to unit length or return zero if v is zero.
+inline __m128 normalise3( __m128 v)
+{
+    const __m128 sq = _mm_mul_ps( v, v);
+    const __m128 s1 = _mm_add_ps( sq, _mm_shuffle_ps( sq, sq, _MM_SHUFFLE(2,3,0,1)));
+    const __m128 s2 = _mm_add_ps( s1, _mm_shuffle_ps( s1, s1, _MM_SHUFFLE(1,0,3,2)));
+    const float len = sqrtf( _mm_cvtss_f32( s2));
+    return len > 0.0f ? _mm_mul_ps( v, _mm_set1_ps( 1.0f/len)) : _mm_setzero_ps();
+}   // end normalise3
+#else
+inline void normalise3( float* n)
+{
+    const float len = sqrtf( n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    const float s = len > 0.0f ? 1.0f/len : 0.0f;
+    n[0] *= s;
+    n[1] *= s;
+    n[2] *= s;
+}   // end normalise3
+#endif
+
+}   // end namespace
+
+
+void RVTK::calcVertexNormals( const RFeatures::ObjModel& model, std::vector<cv::Vec3f>& vnrms, size_t nthreads)
+{
+    assert( model.hasSequentialIds());
+    const size_t nv = model.numVtxs();
+    const size_t nf = model.numPolys();
+    static const size_t MIN_CHUNK = 1 << 14;
+
+    // Copy the vertices (padded to xyz0) and triangles into flat arrays so the accumulation runs over contiguous memory.
+    std::vector<float> vtxs( 4*nv);
+    std::vector<int> tris( 3*nf);
+    parallelChunks( nv, [&]( size_t, size_t b, size_t e)
+    {
+        for ( size_t i = b; i < e; ++i)
+        {
+            memcpy( &vtxs[4*i], &model.uvtx( int(i))[0], 3*sizeof(float));
+            vtxs[4*i+3] = 0.0f;
+        }   // end for
+    }, nthreads, MIN_CHUNK);
+    parallelChunks( nf, [&]( size_t, size_t b, size_t e)
+    {
+        for ( size_t i = b; i < e; ++i)
+            memcpy( &tris[3*i], model.fvidxs( int(i)), 3*sizeof(int));
+    }, nthreads, MIN_CHUNK);
+
+    // Unit face normals (padded to xyz0) calculated in parallel over chunks of faces (degenerate faces get a zero normal).
+    std::vector<float> fnrms( 4*nf);
+    parallelChunks( nf, [&]( size_t, size_t b, size_t e)
+    {
+        const float* V = vtxs.data();
+        const int* T = &tris[3*b];
+        float* n = &fnrms[4*b];
+        for ( size_t f = b; f < e; ++f, T += 3, n += 4)
+        {
+            const float* p0 = &V[4*size_t(T[0])];
+            const float* p1 = &V[4*size_t(T[1])];
+            const float* p2 = &V[4*size_t(T[2])];
+#ifdef RVTK_SSE2
+            const __m128 v0 = _mm_loadu_ps( p0);
+            const __m128 a = _mm_sub_ps( _mm_loadu_ps( p1), v0);
+            const __m128 d = _mm_sub_ps( _mm_loadu_ps( p2), v0);
+            _mm_storeu_ps( n, normalise3( cross3( a, d)));
+#else
+            const float a[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float d[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            n[0] = a[1]*d[2] - a[2]*d[1];
+            n[1] = a[2]*d[0] - a[0]*d[2];
+            n[2] = a[0]*d[1] - a[1]*d[0];
+            n[3] = 0.0f;
+            normalise3( n);
+#endif
+        }   // end for
+    }, nthreads, MIN_CHUNK);
+
+    // Vertex to face incidence in compressed rows (faces in ascending order per vertex).
+    std::vector<int> vfoff( nv+1, 0);
+    for ( size_t i = 0; i < 3*nf; ++i)
+        vfoff[tris[i]+1]++;
+    for ( size_t i = 0; i < nv; ++i)
+        vfoff[i+1] += vfoff[i];
+    std::vector<int> vfids( 3*nf);
+    std::vector<int> vfpos( vfoff.begin(), vfoff.end()-1);
+    for ( size_t i = 0; i < 3*nf; ++i)
+        vfids[vfpos[tris[i]]++] = int(i/3);
+
+    // Gather the face normals per vertex in parallel over the vertices so every vertex
+    // is written by exactly one thread and no per thread buffers are needed.
+    vnrms.resize( nv);
+    parallelChunks( nv, [&]( size_t, size_t b, size_t e)
+    {
+        const float* FN = fnrms.data();
+        for ( size_t i = b; i < e; ++i)
+        {
+#ifdef RVTK_SSE2
+            __m128 acc = _mm_setzero_ps();
+            for ( int j = vfoff[i]; j < vfoff[i+1]; ++j)
+                acc = _mm_add_ps( acc, _mm_loadu_ps( &FN[4*size_t(vfids[j])]));
+            float n[4];
+            _mm_storeu_ps( n, normalise3( acc));
+#else
+            float n[3] = { 0.0f, 0.0f, 0.0f};
+            for ( int j = vfoff[i]; j < vfoff[i+1]; ++j)
+            {
+                const float* fn = &FN[4*size_t(vfids[j])];
+                n[0] += fn[0];
+                n[1] += fn[1];
+                n[2] += fn[2];
+            }   // end for
+            normalise3( n);
+#endif
+            vnrms[i] = cv::Vec3f( n[0], n[1], n[2]);
+        }   // end for
+    }, nthreads, MIN_CHUNK);
+}   // end calcVertexNormals
+
+
 cv::Mat_<cv::Vec3b> RVTK::extractImage( const vtkRenderWindow* renWin)
 {
     vtkRenderWindow* rw = const_cast<vtkRenderWindow*>( renWin);
-    vtkSmartPointer<vtkWindowToImageFilter> filter = vtkSmartPointer<vtkWindowToImageFilter>::New();
-    filter->SetInput( rw);
-    filter->SetScale(1);
-    filter->SetInputBufferTypeToRGB();  // Extract RGB info
-
-    vtkSmartPointer<vtkImageShiftScale> scale = vtkSmartPointer<vtkImageShiftScale>::New();
-    scale->SetOutputScalarTypeToUnsignedChar();
-    scale->SetInputConnection( filter->GetOutputPort());
-
-    vtkSmartPointer<vtkImageExport> exporter = vtkSmartPointer<vtkImageExport>::New();
-    exporter->SetInputConnection( scale->GetOutputPort());
-    exporter->SetImageLowerLeft(false); // Flip vertically for OpenCV
-
-    const int cols = rw->GetSize()[0];
-    const int rows = rw->GetSize()[1];
-    cv::Mat_<cv::Vec3b> img( rows, cols);
-    exporter->SetExportVoidPointer( img.ptr());
-    exporter->Export();
-
-    // Need to swap the red and blue channels for OpenCV
-    cv::cvtColor( img, img, CV_RGB2BGR);
+    rw->Render();   // As vtkWindowToImageFilter did to ensure the buffer is current
+    FrameCapture capture( rw);
+    cv::Mat_<cv::Vec3b> img;
+    capture.readColour( img);
     return img;
 }   // end extractImage
 
@@ -239,28 +390,303 @@ cv::Mat_<cv::Vec3b> RVTK::extractImage( const vtkRenderWindow* renWin)
 cv::Mat_<float> RVTK::extractZBuffer( const vtkRenderWindow* renWin)
 {
     vtkRenderWindow* rw = const_cast<vtkRenderWindow*>( renWin);
-    vtkSmartPointer<vtkWindowToImageFilter> filter = vtkSmartPointer<vtkWindowToImageFilter>::New();
-    filter->SetInput( rw);
-    filter->SetScale(1);
-    filter->SetInputBufferTypeToZBuffer();
-
-    vtkSmartPointer<vtkImageShiftScale> scale = vtkSmartPointer<vtkImageShiftScale>::New();
-    scale->SetOutputScalarTypeToFloat();
-    scale->SetInputConnection( filter->GetOutputPort());
-
-    vtkSmartPointer<vtkImageExport> exporter = vtkSmartPointer<vtkImageExport>::New();
-    exporter->SetInputConnection( scale->GetOutputPort());
-    exporter->SetImageLowerLeft(false); // Flip vertically for OpenCV
-
-    const int cols = rw->GetSize()[0];
-    const int rows = rw->GetSize()[1];
-    cv::Mat_<float> rngMap( rows, cols);
-    exporter->SetExportVoidPointer( rngMap.ptr());
-    exporter->Export();
+    rw->Render();   // As vtkWindowToImageFilter did to ensure the buffer is current
+    FrameCapture capture( rw);
+    cv::Mat_<float> rngMap;
+    capture.readDepth( rngMap);
     return rngMap;
 }   // end extractZBuffer
 
 
+namespace {
+
+const size_t MIN_ROWS_PER_CHUNK = 64;
+
+// Convert sRGB byte values to linear values.
+const float* sRGBToLinear()
+{
+    static const std::vector<float> lut = []()
+    {
+        std::vector<float> t(256);
+        for ( int i = 0; i < 256; ++i)
+        {
+            const float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : powf( (c + 0.055f) / 1.055f, 2.4f);
+        }   // end for
+        return t;
+    }();
+    return &lut[0];
+}   // end sRGBToLinear
+
+
+const int Y_LUT_SIZE = 1 << 14;
+
+// Convert relative luminance Y in [0,1] (indexed over Y_LUT_SIZE bins) to CIE-L scaled to [0,255].
+const unsigned char* luminanceToLightness()
+{
+    static const std::vector<unsigned char> lut = []()
+    {
+        std::vector<unsigned char> t(Y_LUT_SIZE+1);
+        for ( int i = 0; i <= Y_LUT_SIZE; ++i)
+        {
+            const float y = float(i) / Y_LUT_SIZE;
+            const float L = y > 0.008856f ? 116.0f * cbrtf(y) - 16.0f : 903.3f * y;
+            t[i] = cv::saturate_cast<unsigned char>( L * 255.0f / 100.0f);
+        }   // end for
+        return t;
+    }();
+    return &lut[0];
+}   // end luminanceToLightness
+
+
+// Set rows [b,e) of lmap to the (unstretched) lightness of the same rows of img updating the range [mn,mx].
+// The per channel table lookups don't vectorise so this is a scalar loop.
+void lightnessRows( const cv::Mat_<cv::Vec3b>& img, cv::Mat_<unsigned char>& lmap, size_t b, size_t e,
+                    unsigned char& mn, unsigned char& mx)
+{
+    const float* lin = sRGBToLinear();
+    const unsigned char* ltab = luminanceToLightness();
+    // D65 luminance weights premultiplied by the lookup table size.
+    const float wb = 0.072169f * Y_LUT_SIZE;
+    const float wg = 0.715160f * Y_LUT_SIZE;
+    const float wr = 0.212671f * Y_LUT_SIZE;
+    const int cols = img.cols;
+    for ( size_t i = b; i < e; ++i)
+    {
+        const unsigned char* prow = img.ptr<unsigned char>(int(i));
+        unsigned char* lrow = lmap.ptr<unsigned char>(int(i));
+        for ( int j = 0; j < cols; ++j)
+        {
+            const unsigned char* p = &prow[3*j];
+            const int yidx = int( wb*lin[p[0]] + wg*lin[p[1]] + wr*lin[p[2]] + 0.5f);
+            const unsigned char L = ltab[std::min( yidx, Y_LUT_SIZE)];
+            lrow[j] = L;
+            mn = std::min( mn, L);
+            mx = std::max( mx, L);
+        }   // end for
+    }   // end for
+}   // end lightnessRows
+
+
+// Update the range [mn,mx] with rows [b,e) of the Z-buffer (using OpenCV's vectorised minMaxIdx).
+void depthRange( const cv::Mat_<float>& zbuff, size_t b, size_t e, float& mn, float& mx)
+{
+    double zmn, zmx;
+    cv::minMaxIdx( zbuff.rowRange( int(b), int(e)), &zmn, &zmx);
+    mn = std::min( mn, float(zmn));
+    mx = std::max( mx, float(zmx));
+}   // end depthRange
+
+
+// Set rows [b,e) of dmap to 255 - (z - mn) * scale saturated (using OpenCV's vectorised convertTo).
+void depthBytes( const cv::Mat_<float>& zbuff, cv::Mat_<unsigned char>& dmap, size_t b, size_t e, float mn, float scale)
+{
+    cv::Mat drows = dmap.rowRange( int(b), int(e));
+    zbuff.rowRange( int(b), int(e)).convertTo( drows, CV_8U, -scale, 255.0 + double(mn) * scale);
+}   // end depthBytes
+
+
+// Stretch rows [b,e) of lmap in place through the given 256 entry table (using OpenCV's LUT).
+void stretchRows( cv::Mat_<unsigned char>& lmap, size_t b, size_t e, const cv::Mat& lut)
+{
+    cv::Mat lrows = lmap.rowRange( int(b), int(e));
+    cv::LUT( lrows, lut, lrows);
+}   // end stretchRows
+
+
+// The lookup table stretching lightness range [mn,mx] over [0,255].
+cv::Mat stretchTable( int mn, int mx)
+{
+    cv::Mat lut( 1, 256, CV_8UC1);
+    const float scale = mx > mn ? 255.0f / (mx - mn) : 0.0f;
+    for ( int i = 0; i < 256; ++i)
+        lut.at<unsigned char>(i) = cv::saturate_cast<unsigned char>( (i - mn) * scale);
+    return lut;
+}   // end stretchTable
+
+}   // end namespace
+
+
+void RVTK::unprojectZBuffer( vtkCamera* cam, double aspect, const cv::Mat_<float>& zbuff,
+                             cv::Mat_<float>* edepth, cv::Mat_<cv::Vec3f>* points, size_t nthreads,
+                             const cv::Vec4d& vp)
+{
+    const int rows = zbuff.rows;
+    const int cols = zbuff.cols;
+    if ( edepth)
+        edepth->create( rows, cols);
+    if ( points)
+        points->create( rows, cols);
+    if ( zbuff.empty() || (!edepth && !points))
+        return;
+
+    // Inverse of the world to normalised device coordinates transform with NDC z in [-1,1].
+    vtkSmartPointer<vtkMatrix4x4> ivm = vtkSmartPointer<vtkMatrix4x4>::New();
+    ivm->DeepCopy( cam->GetCompositeProjectionTransformMatrix( aspect, -1, 1));
+    ivm->Invert();
+    const cv::Matx44d M = toCV( ivm);
+
+    // Columns of the inverse for the x, y, z and w NDC components. The unprojection is done in double
+    // because the homogeneous divide loses too much precision in float towards the far plane.
+    cv::Vec4d cx, cy, cz, cw;
+    for ( int k = 0; k < 4; ++k)
+    {
+        cx[k] = M(k,0);
+        cy[k] = M(k,1);
+        cz[k] = M(k,2);
+        cw[k] = M(k,3);
+    }   // end for
+
+    cv::Vec3d cpos, cdir;
+    cam->GetPosition( &cpos[0]);
+    cam->GetDirectionOfProjection( &cdir[0]);
+    const float qnan = std::numeric_limits<float>::quiet_NaN();
+
+    // Pixel centres map to NDC over the viewport (in VTK's normalised bottom up display coordinates)
+    // so pixels outside it (where the Z-buffer holds some other renderer's depths) are background.
+    const double vpw = std::max( vp[2] - vp[0], DBL_EPSILON);
+    const double vph = std::max( vp[3] - vp[1], DBL_EPSILON);
+
+    RVTK::parallelChunks( size_t(rows), [&]( size_t, size_t b, size_t e)
+    {
+        for ( size_t i = b; i < e; ++i)
+        {
+            const double y = 2.0 * (1.0 - (double(i) + 0.5) / rows - vp[1]) / vph - 1.0;
+            const bool rowIn = y >= -1.0 && y <= 1.0;
+            const cv::Vec4d rbase = y * cy + cw;    // Constant over the row
+            const float* zrow = zbuff.ptr<float>(int(i));
+            float* drow = edepth ? edepth->ptr<float>(int(i)) : nullptr;
+            cv::Vec3f* prow = points ? points->ptr<cv::Vec3f>(int(i)) : nullptr;
+            for ( int j = 0; j < cols; ++j)
+            {
+                const float z = zrow[j];
+                const double x = 2.0 * ((double(j) + 0.5) / cols - vp[0]) / vpw - 1.0;
+                if ( z >= 1.0f || !rowIn || x < -1.0 || x > 1.0)
+                {
+                    if ( drow)
+                        drow[j] = 0.0f;
+                    if ( prow)
+                        prow[j] = cv::Vec3f( qnan, qnan, qnan);
+                    continue;
+                }   // end if
+
+                const cv::Vec4d h = rbase + x * cx + (2.0 * double(z) - 1.0) * cz;
+                const double iw = 1.0 / h[3];
+                const cv::Vec3d wp( h[0]*iw, h[1]*iw, h[2]*iw);
+                if ( drow)
+                    drow[j] = float( (wp - cpos).dot( cdir));
+                if ( prow)
+                    prow[j] = cv::Vec3f( float(wp[0]), float(wp[1]), float(wp[2]));
+            }   // end for
+        }   // end for
+    }, nthreads, MIN_ROWS_PER_CHUNK);
+}   // end unprojectZBuffer
+
+
+void RVTK::makeDepthByteMap( const cv::Mat_<float>& zbuff, cv::Mat_<unsigned char>& dmap, float depthProp, size_t nthreads)
+{
+    const int rows = zbuff.rows;
+    dmap.create( rows, zbuff.cols);
+    if ( zbuff.empty())
+        return;
+
+    const size_t nchunks = RVTK::numChunks( size_t(rows), nthreads, MIN_ROWS_PER_CHUNK);
+    std::vector<float> mns( nchunks, FLT_MAX);
+    std::vector<float> mxs( nchunks, -FLT_MAX);
+    RVTK::parallelChunks( size_t(rows), [&]( size_t c, size_t b, size_t e)
+    {
+        depthRange( zbuff, b, e, mns[c], mxs[c]);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+
+    const float mn = *std::min_element( mns.begin(), mns.end());
+    const float mx = *std::max_element( mxs.begin(), mxs.end());
+    const float rng = (mx - mn) * depthProp;
+    const float scale = rng > 0 ? 255.0f / rng : 0.0f;
+
+    RVTK::parallelChunks( size_t(rows), [&]( size_t, size_t b, size_t e)
+    {
+        depthBytes( zbuff, dmap, b, e, mn, scale);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+}   // end makeDepthByteMap
+
+
+void RVTK::makeStretchedLightness( const cv::Mat_<cv::Vec3b>& img, cv::Mat_<unsigned char>& lmap, size_t nthreads)
+{
+    const int rows = img.rows;
+    lmap.create( rows, img.cols);
+    if ( img.empty())
+        return;
+
+    const size_t nchunks = RVTK::numChunks( size_t(rows), nthreads, MIN_ROWS_PER_CHUNK);
+    std::vector<unsigned char> mns( nchunks, 255);
+    std::vector<unsigned char> mxs( nchunks, 0);
+    RVTK::parallelChunks( size_t(rows), [&]( size_t c, size_t b, size_t e)
+    {
+        lightnessRows( img, lmap, b, e, mns[c], mxs[c]);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+
+    const int mn = *std::min_element( mns.begin(), mns.end());
+    const int mx = *std::max_element( mxs.begin(), mxs.end());
+    if ( mn == 0 && mx == 255)
+        return;
+
+    const cv::Mat lut = stretchTable( mn, mx);
+    RVTK::parallelChunks( size_t(rows), [&]( size_t, size_t b, size_t e)
+    {
+        stretchRows( lmap, b, e, lut);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+}   // end makeStretchedLightness
+
+
+void RVTK::makeLightnessAndDepthMaps( const cv::Mat_<cv::Vec3b>& img, const cv::Mat_<float>& zbuff,
+                                      cv::Mat_<unsigned char>& lmap, cv::Mat_<unsigned char>& dmap,
+                                      float depthProp, size_t nthreads)
+{
+    if ( img.size() != zbuff.size())
+    {
+        makeStretchedLightness( img, lmap, nthreads);
+        makeDepthByteMap( zbuff, dmap, depthProp, nthreads);
+        return;
+    }   // end if
+
+    const int rows = img.rows;
+    lmap.create( rows, img.cols);
+    dmap.create( rows, img.cols);
+    if ( img.empty())
+        return;
+
+    // First sweep: lightness with its range and the Z-buffer's range over the same rows.
+    const size_t nchunks = RVTK::numChunks( size_t(rows), nthreads, MIN_ROWS_PER_CHUNK);
+    std::vector<unsigned char> lmns( nchunks, 255);
+    std::vector<unsigned char> lmxs( nchunks, 0);
+    std::vector<float> zmns( nchunks, FLT_MAX);
+    std::vector<float> zmxs( nchunks, -FLT_MAX);
+    RVTK::parallelChunks( size_t(rows), [&]( size_t c, size_t b, size_t e)
+    {
+        lightnessRows( img, lmap, b, e, lmns[c], lmxs[c]);
+        depthRange( zbuff, b, e, zmns[c], zmxs[c]);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+
+    const int lmn = *std::min_element( lmns.begin(), lmns.end());
+    const int lmx = *std::max_element( lmxs.begin(), lmxs.end());
+    const bool stretch = lmn > 0 || lmx < 255;
+    const cv::Mat lut = stretch ? stretchTable( lmn, lmx) : cv::Mat();
+
+    const float zmn = *std::min_element( zmns.begin(), zmns.end());
+    const float zmx = *std::max_element( zmxs.begin(), zmxs.end());
+    const float rng = (zmx - zmn) * depthProp;
+    const float scale = rng > 0 ? 255.0f / rng : 0.0f;
+
+    // Second sweep: stretch the lightness and write the depth bytes.
+    RVTK::parallelChunks( size_t(rows), [&]( size_t, size_t b, size_t e)
+    {
+        if ( stretch)
+            stretchRows( lmap, b, e, lut);
+        depthBytes( zbuff, dmap, b, e, zmn, scale);
+    }, nchunks, MIN_ROWS_PER_CHUNK);
+}   // end makeLightnessAndDepthMaps
+
+
 void RVTK::printCameraDetails( vtkCamera* cam, std::ostream &os)
 {
     using std::endl;
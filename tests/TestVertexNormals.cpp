@@ -0,0 +1,139 @@
+/************************************************************************
+ * Copyright (C) 2017 Richard Palmer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+// Checks RVTK::calcVertexNormals against vtkPolyDataNormals run without consistency reordering
+// or splitting (which is what it's defined to match) and that the result doesn't depend on
+// the number of threads used.
+
+#include <VtkTools.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+using RFeatures::ObjModel;
+
+
+namespace {
+
+// Wavy grid of 2 x w x h triangles.
+ObjModel::Ptr makeGrid( int w, int h)
+{
+    ObjModel::Ptr model = ObjModel::create();
+    for ( int y = 0; y <= h; ++y)
+        for ( int x = 0; x <= w; ++x)
+            model->addVertex( float(x), float(y), 2.0f * std::sin( 0.3f*x) * std::cos( 0.2f*y));
+    for ( int y = 0; y < h; ++y)
+    {
+        for ( int x = 0; x < w; ++x)
+        {
+            const int v0 = y*(w+1) + x;
+            model->addFace( v0, v0 + 1, v0 + w + 2);
+            model->addFace( v0, v0 + w + 2, v0 + w + 1);
+        }   // end for
+    }   // end for
+    return model;
+}   // end makeGrid
+
+
+// Randomly perturbed grid so vertices have irregular fans of faces.
+ObjModel::Ptr makeNoisyGrid( int w, int h)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter( -0.3f, 0.3f);
+    ObjModel::Ptr model = ObjModel::create();
+    for ( int y = 0; y <= h; ++y)
+        for ( int x = 0; x <= w; ++x)
+            model->addVertex( x + jitter(rng), y + jitter(rng), jitter(rng));
+    for ( int y = 0; y < h; ++y)
+    {
+        for ( int x = 0; x < w; ++x)
+        {
+            const int v0 = y*(w+1) + x;
+            model->addFace( v0, v0 + 1, v0 + w + 2);
+            model->addFace( v0, v0 + w + 2, v0 + w + 1);
+        }   // end for
+    }   // end for
+    return model;
+}   // end makeNoisyGrid
+
+
+vtkSmartPointer<vtkPolyData> toPolyData( const ObjModel& model)
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    const int nv = model.numVtxs();
+    points->SetNumberOfPoints( nv);
+    for ( int i = 0; i < nv; ++i)
+        points->SetPoint( i, &model.uvtx(i)[0]);
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    const int nf = model.numPolys();
+    for ( int f = 0; f < nf; ++f)
+    {
+        const int* fvidxs = model.fvidxs(f);
+        const vtkIdType ids[3] = { fvidxs[0], fvidxs[1], fvidxs[2]};
+        polys->InsertNextCell( 3, ids);
+    }   // end for
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints( points);
+    pd->SetPolys( polys);
+    return pd;
+}   // end toPolyData
+
+
+bool check( const std::string& name, const ObjModel& model)
+{
+    std::vector<cv::Vec3f> vnrms, vnrms1;
+    RVTK::calcVertexNormals( model, vnrms);
+    RVTK::calcVertexNormals( model, vnrms1, 1);
+
+    vtkDataArray* vn = RVTK::generateNormals( toPolyData( model), false, false)->GetPointData()->GetNormals();
+    if ( !vn || vn->GetNumberOfTuples() != vtkIdType( vnrms.size()))
+    {
+        std::cerr << name << ": VTK gave a different number of normals" << std::endl;
+        return false;
+    }   // end if
+
+    double n[3];
+    for ( size_t i = 0; i < vnrms.size(); ++i)
+    {
+        const cv::Vec3f& v = vnrms[i];
+        if ( v != vnrms1[i])
+        {
+            std::cerr << name << ": normal " << i << " differs with the number of threads" << std::endl;
+            return false;
+        }   // end if
+        vn->GetTuple( vtkIdType(i), n);
+        if ( n[0]*v[0] + n[1]*v[1] + n[2]*v[2] < 0.9999)
+        {
+            std::cerr << name << ": normal " << i << " differs from vtkPolyDataNormals" << std::endl;
+            return false;
+        }   // end if
+    }   // end for
+    return true;
+}   // end check
+
+}   // end namespace
+
+
+int main()
+{
+    bool ok = check( "grid", *makeGrid( 300, 200));
+    ok = check( "noisy grid", *makeNoisyGrid( 400, 300)) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}   // end main